@@ -0,0 +1,177 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+// Measures stream throughput over the SimConnect loopback for different stripe counts.
+//
+// The sim publishes an ON_SET client data area at most once per frame, so a stream using a single
+// data area is limited to one chunk per frame. Striping distributes the chunks round-robin over
+// several areas which are all published in the same frame.
+//
+// Usage: stream-striping-bench [repetitions]
+// The link is configured with the LOOPBACK_* environment variables - LOOPBACK_FRAME_US defaults to 60 fps.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SimConnect.h>
+#include "SimConnectLoopback.h"
+
+#include "fingerprint.h"
+#include "longtext.h"
+#include "slidingwindow.h"
+#include "streamprotocol.h"
+#include "streamreassembler.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr SIMCONNECT_CLIENT_DATA_DEFINITION_ID CHUNK_DEFINITION_ID = 0;
+constexpr SIMCONNECT_CLIENT_DATA_DEFINITION_ID ACK_DEFINITION_ID = 1;
+constexpr SIMCONNECT_CLIENT_DATA_ID ACK_ID = 0;
+constexpr SIMCONNECT_CLIENT_DATA_ID ACK_ECHO_ID = 1;
+constexpr SIMCONNECT_CLIENT_DATA_ID DATA_ID = 100;  // DATA_ID + stripe
+constexpr SIMCONNECT_CLIENT_DATA_ID ECHO_ID = 200;  // ECHO_ID + stripe
+constexpr SIMCONNECT_DATA_REQUEST_ID ACK_REQUEST_ID = 0;
+constexpr SIMCONNECT_DATA_REQUEST_ID ECHO_REQUEST_ID = 100;  // ECHO_REQUEST_ID + stripe
+
+const std::string ACK_NAME = "BENCH ACK";
+const std::string ACK_ECHO_NAME = "BENCH ACK ECHO";
+const std::string DATA_NAME = "BENCH DATA";
+const std::string ECHO_NAME = "BENCH ECHO";
+
+struct Result {
+  double seconds = 0.0;
+  uint64_t retransmits = 0;
+  uint64_t coalesced = 0;
+  bool match = false;
+};
+
+std::string stripeName(const std::string& name, uint32_t stripe) {
+  return name + " " + std::to_string(stripe);
+}
+
+/**
+ * Streams data once from the DATA stripes to the ECHO stripes (mirrored by the loopback peer) and
+ * acknowledges the chunks through the ACK area like the WASM module would.
+ */
+Result runTransfer(const std::string& data, uint32_t stripes, uint32_t window) {
+  HANDLE hSimConnect{};
+  SimConnect_Open(&hSimConnect, "Stream Striping Bench", nullptr, 0, nullptr, 0);
+
+  SimConnect_AddToClientDataDefinition(hSimConnect, CHUNK_DEFINITION_ID, 0, StreamChunkSize);
+  SimConnect_AddToClientDataDefinition(hSimConnect, ACK_DEFINITION_ID, 0, sizeof(StreamAck));
+  SimConnect_MapClientDataNameToID(hSimConnect, ACK_NAME.c_str(), ACK_ID);
+  SimConnect_CreateClientData(hSimConnect, ACK_ID, sizeof(StreamAck), SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT);
+  SimConnect_MapClientDataNameToID(hSimConnect, ACK_ECHO_NAME.c_str(), ACK_ECHO_ID);
+  SimConnect_RequestClientData(hSimConnect, ACK_ECHO_ID, ACK_REQUEST_ID, ACK_DEFINITION_ID, SIMCONNECT_CLIENT_DATA_PERIOD_ON_SET);
+  SimConnectLoopback::mirrorClientData(ACK_NAME, ACK_ECHO_NAME);
+  for (uint32_t stripe = 0; stripe < stripes; stripe++) {
+    SimConnect_MapClientDataNameToID(hSimConnect, stripeName(DATA_NAME, stripe).c_str(), DATA_ID + stripe);
+    SimConnect_CreateClientData(hSimConnect, DATA_ID + stripe, StreamChunkSize, SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT);
+    SimConnect_MapClientDataNameToID(hSimConnect, stripeName(ECHO_NAME, stripe).c_str(), ECHO_ID + stripe);
+    SimConnect_RequestClientData(hSimConnect, ECHO_ID + stripe, ECHO_REQUEST_ID + stripe, CHUNK_DEFINITION_ID,
+                                 SIMCONNECT_CLIENT_DATA_PERIOD_ON_SET);
+    SimConnectLoopback::mirrorClientData(stripeName(DATA_NAME, stripe), stripeName(ECHO_NAME, stripe));
+  }
+
+  StreamMetaData meta{};
+  meta.size = data.size();
+  meta.hash = fingerprint(data.data(), data.size(), DefaultFingerprintAlgorithm);
+  meta.algorithm = DefaultFingerprintAlgorithm;
+  meta.ackWindow = window;
+  meta.stripeCount = stripes;
+  const size_t payloadSize = streamChunkPayloadSize(hasChunkHeader(meta));
+
+  StreamReassembler reassembler;
+  reassembler.start(meta);
+  SlidingWindowSender sender(window, std::chrono::milliseconds(250));
+  sender.start(static_cast<uint32_t>(chunkCount(data.size(), payloadSize)));
+  SimConnectLoopback::resetStats();
+
+  std::vector<char> buffer(StreamChunkSize);
+  StreamAck ack{};
+  const auto sendChunk = [&](uint32_t sequence) {
+    const size_t offset = sequence * payloadSize;
+    const size_t size = std::min(payloadSize, data.size() - offset);
+    const StreamChunkHeader header{.sequence = sequence, .streamId = 0};
+    const size_t headerSize = hasChunkHeader(meta) ? sizeof(StreamChunkHeader) : 0;
+    std::memcpy(buffer.data(), &header, headerSize);
+    std::memcpy(buffer.data() + headerSize, data.data() + offset, size);
+    return SUCCEEDED(SimConnect_SetClientData(hSimConnect, DATA_ID + sequence % stripes, CHUNK_DEFINITION_ID,
+                                              SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, StreamChunkSize, buffer.data()));
+  };
+
+  const auto start = Clock::now();
+  while (sender.isActive()) {
+    sender.pump(sendChunk);
+    SIMCONNECT_RECV* pData = nullptr;
+    DWORD cbData = 0;
+    while (SUCCEEDED(SimConnect_GetNextDispatch(hSimConnect, &pData, &cbData))) {
+      if (pData->dwID != SIMCONNECT_RECV_ID_CLIENT_DATA) {
+        continue;
+      }
+      const auto* pClientData = reinterpret_cast<SIMCONNECT_RECV_CLIENT_DATA*>(pData);
+      if (pClientData->dwRequestID == ACK_REQUEST_ID) {
+        std::memcpy(&ack, &pClientData->dwData, sizeof(StreamAck));
+        sender.onAck(ack.ackedChunks);
+      } else {
+        reassembler.onChunk(reinterpret_cast<const char*>(&pClientData->dwData));
+        ack.ackedChunks = reassembler.ackedChunks();
+        SimConnect_SetClientData(hSimConnect, ACK_ID, ACK_DEFINITION_ID, SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, sizeof(StreamAck),
+                                 &ack);
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+  Result result{};
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  result.retransmits = sender.retransmitCount();
+  result.coalesced = SimConnectLoopback::stats().messagesCoalesced;
+  result.match = reassembler.isComplete() && reassembler.digest() == meta.hash;
+  SimConnect_Close(hSimConnect);
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const int repetitions = argc > 1 ? std::max(1, std::stoi(argv[1])) : 3;
+
+  auto config = SimConnectLoopback::Config::fromEnvironment();
+  if (config.framePeriod.count() == 0) {
+    config.framePeriod = std::chrono::microseconds(16667);
+  }
+  SimConnectLoopback::configure(config);
+
+  std::cout << "Stream striping benchmark - " << longText.size() << " bytes, frame period " << config.framePeriod.count() << " us, "
+            << repetitions << " repetitions" << std::endl;
+  std::cout << std::setw(8) << "stripes" << std::setw(8) << "window" << std::setw(12) << "ms" << std::setw(14) << "bytes/sec"
+            << std::setw(12) << "retransmit" << std::setw(11) << "coalesced" << std::setw(8) << "match" << std::endl;
+
+  for (const uint32_t stripes : {1U, 2U, 4U, 8U, 16U}) {
+    double seconds = 0.0;
+    uint64_t retransmits = 0;
+    uint64_t coalesced = 0;
+    bool match = true;
+    for (int i = 0; i < repetitions; i++) {
+      const Result result = runTransfer(longText, stripes, stripes);
+      seconds += result.seconds;
+      retransmits += result.retransmits;
+      coalesced += result.coalesced;
+      match = match && result.match;
+    }
+    seconds /= repetitions;
+    std::cout << std::setw(8) << stripes << std::setw(8) << stripes << std::setw(12) << std::fixed << std::setprecision(1)
+              << seconds * 1000.0 << std::setw(14) << std::setprecision(0) << static_cast<double>(longText.size()) / seconds
+              << std::setw(12) << retransmits << std::setw(11) << coalesced << std::setw(8) << std::boolalpha << match << std::endl;
+  }
+  return 0;
+}
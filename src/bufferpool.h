@@ -0,0 +1,133 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_BUFFERPOOL_H
+#define FBW_CPP_FRAMEWORK_TEST_BUFFERPOOL_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Pool of byte buffers in power of two size classes - e.g. for reassembling received streams.
+ *
+ * acquire() hands out a buffer of the requested size from the free list of its size class and only
+ * allocates when the list is empty. release() puts the buffer back as long as the free buffers stay
+ * below maxResidentBytes. Once the pool holds a buffer of every size class in use, streaming
+ * performs no allocations. The content of an acquired buffer is undefined - released buffers keep
+ * their size so acquiring a buffer of the same size does not even clear it. Buffers above the
+ * largest size class are allocated with their exact size and freed on release.
+ *
+ * Not thread safe.
+ *
+ * Usage:
+ *
+ * auto buffer = pool.acquire(size);
+ * ...
+ * pool.release(std::move(buffer));
+ */
+class BufferPool {
+ public:
+  /** Counters of the pool. */
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    /** released buffers which were freed because the pool was full */
+    uint64_t discarded = 0;
+    /** acquired buffers above the largest size class - allocated and freed without the pool */
+    uint64_t unpooled = 0;
+    /** capacity of the free buffers held by the pool */
+    size_t residentBytes = 0;
+    /** capacity of the buffers currently handed out */
+    size_t outstandingBytes = 0;
+  };
+
+  static constexpr size_t MIN_CLASS_SIZE = 4096;
+  static constexpr size_t CLASS_COUNT = 48;
+  static constexpr size_t MAX_CLASS_SIZE = MIN_CLASS_SIZE << (CLASS_COUNT - 1);
+
+  /**
+   * @param maxResidentBytes capacity of the free buffers the pool holds at most
+   * @param maxClassSize size of the largest size class - rounded up to a power of two times MIN_CLASS_SIZE, capped at MAX_CLASS_SIZE
+   */
+  explicit BufferPool(size_t maxResidentBytes, size_t maxClassSize = MAX_CLASS_SIZE)
+      : maxResident(maxResidentBytes), classCount(classOf(std::min(maxClassSize, MAX_CLASS_SIZE), CLASS_COUNT) + 1) {}
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  /** @return a buffer of size bytes with a capacity of its size class */
+  std::vector<char> acquire(size_t size) {
+    const size_t sizeClass = classOf(size, classCount);
+    if (sizeClass == classCount) {
+      counters.unpooled++;
+      std::vector<char> buffer(size);
+      counters.outstandingBytes += buffer.capacity();
+      return buffer;
+    }
+    auto& list = freeLists[sizeClass];
+    std::vector<char> buffer;
+    if (list.empty()) {
+      counters.misses++;
+      buffer.reserve(MIN_CLASS_SIZE << sizeClass);
+    } else {
+      counters.hits++;
+      buffer = std::move(list.back());
+      list.pop_back();
+      counters.residentBytes -= buffer.capacity();
+    }
+    buffer.resize(size);
+    counters.outstandingBytes += buffer.capacity();
+    return buffer;
+  }
+
+  /** Returns a buffer - buffers which were not acquired from the pool are accepted as well. */
+  void release(std::vector<char>&& buffer) {
+    const size_t capacity = buffer.capacity();
+    if (capacity == 0) {
+      return;
+    }
+    counters.outstandingBytes -= std::min(counters.outstandingBytes, capacity);
+    // a buffer serves the largest class it fully covers - buffers above the largest class are not pooled
+    size_t sizeClass = classOf(capacity, classCount);
+    if (sizeClass == classCount) {
+      std::vector<char>().swap(buffer);
+      return;
+    }
+    if ((MIN_CLASS_SIZE << sizeClass) > capacity) {
+      if (sizeClass == 0) {
+        counters.discarded++;
+        std::vector<char>().swap(buffer);
+        return;
+      }
+      sizeClass--;
+    }
+    if (counters.residentBytes + capacity > maxResident) {
+      counters.discarded++;
+      std::vector<char>().swap(buffer);
+      return;
+    }
+    counters.residentBytes += capacity;
+    freeLists[sizeClass].push_back(std::move(buffer));
+  }
+
+  [[nodiscard]] const Stats& stats() const { return counters; }
+
+ private:
+  std::array<std::vector<std::vector<char>>, CLASS_COUNT> freeLists{};
+  size_t maxResident;
+  size_t classCount;
+  Stats counters{};
+
+  /** @return the smallest size class holding size bytes - classCount if size is above the largest class */
+  static size_t classOf(size_t size, size_t classCount) {
+    size_t sizeClass = 0;
+    while (sizeClass < classCount && (MIN_CLASS_SIZE << sizeClass) < size) {
+      sizeClass++;
+    }
+    return sizeClass;
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_BUFFERPOOL_H
@@ -0,0 +1,180 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_CHROMETRACE_H
+#define FBW_CPP_FRAMEWORK_TEST_CHROMETRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Scoped trace spans exported in the Chrome trace event format - the file opens in chrome://tracing
+ * and in Perfetto (ui.perfetto.dev).
+ *
+ * TRACE_SPAN(name, category) measures the rest of the enclosing scope on the calling thread.
+ * TRACE_COMPLETE(name, category, begin) adds a span from begin until now - for phases which do not
+ * fit a scope. Names and categories must be string literals. Spans are only recorded between
+ * chromeTrace->start() and chromeTrace->write() - otherwise a span costs one load and branch.
+ *
+ * Compiling with CHROME_TRACE=0 removes all spans like the LOG_*_BLOCK macros of the log levels.
+ * TRACE_BLOCK(...) holds code which is only needed for tracing.
+ *
+ * Usage:
+ *
+ * chromeTrace->start(100000);
+ * void getDispatch() {
+ *   TRACE_SPAN("getDispatch", "dispatch");
+ *   ...
+ * }
+ * chromeTrace->write("trace.json");
+ */
+#ifndef CHROME_TRACE
+#define CHROME_TRACE 1
+#endif
+
+#if CHROME_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(name, category) const ChromeTraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, category)
+#define TRACE_COMPLETE(name, category, begin) \
+  (chromeTrace->isRecording() ? chromeTrace->add(name, category, begin, ChromeTrace::Clock::now()) : void(0))
+#define TRACE_THREAD_NAME(name) chromeTrace->setThreadName(name)
+#define TRACE_BLOCK(...) __VA_ARGS__
+#else
+#define TRACE_SPAN(name, category) void(0)
+#define TRACE_COMPLETE(name, category, begin) void(0)
+#define TRACE_THREAD_NAME(name) void(0)
+#define TRACE_BLOCK(...) void(0);
+#endif
+
+/**
+ * Collects the spans of all threads and writes them as Chrome trace JSON.
+ */
+class ChromeTrace {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static ChromeTrace* instance() {
+    static ChromeTrace instance;
+    return &instance;
+  }
+
+  ChromeTrace(const ChromeTrace&) = delete;
+  ChromeTrace& operator=(const ChromeTrace&) = delete;
+
+  /** Starts recording spans. At most capacity spans are kept - later spans are counted as dropped. */
+  void start(size_t capacity) {
+    std::lock_guard lock(mutex);
+    spans.clear();
+    spans.reserve(capacity);
+    maxSpans = capacity;
+    dropped = 0;
+    startTime = Clock::now();
+    recording.store(true, std::memory_order_release);
+  }
+
+  [[nodiscard]] bool isRecording() const { return recording.load(std::memory_order_relaxed); }
+
+  /** Names the calling thread in the trace. */
+  void setThreadName(std::string name) {
+    std::lock_guard lock(mutex);
+    threadNames.emplace_back(threadNumber(), std::move(name));
+  }
+
+  /** Adds a finished span - use TRACE_SPAN. */
+  void add(const char* name, const char* category, Clock::time_point begin, Clock::time_point end) {
+    const uint32_t thread = threadNumber();
+    std::lock_guard lock(mutex);
+    if (spans.size() >= maxSpans) {
+      dropped++;
+      return;
+    }
+    spans.push_back({name, category, thread, begin, end - begin});
+  }
+
+  /**
+   * Stops recording and writes the recorded spans.
+   * @return false if the file could not be written
+   */
+  bool write(const std::string& path) {
+    recording.store(false, std::memory_order_release);
+    std::lock_guard lock(mutex);
+    std::ofstream out(path);
+    out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedSpans\":" << dropped << "},\"traceEvents\":[\n";
+    const char* separator = "";
+    for (const auto& [thread, name] : threadNames) {
+      out << separator << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << thread << R"(,"args":{"name":")" << name << "\"}}";
+      separator = ",\n";
+    }
+    for (const auto& span : spans) {
+      out << separator << R"({"name":")" << span.name << R"(","cat":")" << span.category << R"(","ph":"X","pid":1,"tid":)" << span.thread
+          << ",\"ts\":" << microseconds(span.begin - startTime) << ",\"dur\":" << microseconds(span.duration) << "}";
+      separator = ",\n";
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+  }
+
+ private:
+  struct Span {
+    const char* name;
+    const char* category;
+    uint32_t thread;
+    Clock::time_point begin;
+    Clock::duration duration;
+  };
+
+  ChromeTrace() = default;
+
+  std::atomic<bool> recording{false};
+  std::mutex mutex;
+  std::vector<Span> spans;
+  size_t maxSpans = 0;
+  uint64_t dropped = 0;
+  Clock::time_point startTime{};
+  std::vector<std::pair<uint32_t, std::string>> threadNames;
+
+  static double microseconds(Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); }
+
+  static uint32_t threadNumber() {
+    static std::atomic<uint32_t> nextThread{1};
+    thread_local const uint32_t number = nextThread.fetch_add(1, std::memory_order_relaxed);
+    return number;
+  }
+};
+
+inline ChromeTrace* chromeTrace = ChromeTrace::instance();
+
+/**
+ * Records the time from its construction to its destruction as a span - use TRACE_SPAN.
+ */
+class ChromeTraceSpan {
+ public:
+  ChromeTraceSpan(const char* name, const char* category) : name(name), category(category) {
+    if (chromeTrace->isRecording()) {
+      begin = ChromeTrace::Clock::now();
+    }
+  }
+
+  ~ChromeTraceSpan() {
+    if (begin != ChromeTrace::Clock::time_point{} && chromeTrace->isRecording()) {
+      chromeTrace->add(name, category, begin, ChromeTrace::Clock::now());
+    }
+  }
+
+  ChromeTraceSpan(const ChromeTraceSpan&) = delete;
+  ChromeTraceSpan& operator=(const ChromeTraceSpan&) = delete;
+
+ private:
+  const char* name;
+  const char* category;
+  ChromeTrace::Clock::time_point begin{};
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_CHROMETRACE_H
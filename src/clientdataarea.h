@@ -0,0 +1,262 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_CLIENTDATAAREA_H
+#define FBW_CPP_FRAMEWORK_TEST_CLIENTDATAAREA_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "SimConnect.h"
+#include "logging.h"
+#include "sendqueue.h"
+#include "trafficcapture.h"
+
+/**
+ * Who writes a client data area.
+ */
+enum class ClientDataDirection {
+  /** we create the area and write to it */
+  SEND,
+  /** the sim writes the area - its content is delivered every time it is set */
+  RECEIVE,
+  /** the sim writes the area - its content is only delivered when requested with ClientDataArea::request() */
+  REQUEST,
+};
+
+/**
+ * Type erased part of a client data area - holds the IDs assigned by the registry.
+ */
+class ClientDataAreaBase {
+ public:
+  virtual ~ClientDataAreaBase() = default;
+
+  [[nodiscard]] const std::string& name() const { return areaName; }
+  [[nodiscard]] SIMCONNECT_CLIENT_DATA_ID id() const { return areaId; }
+  [[nodiscard]] SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId() const { return areaDefinitionId; }
+  [[nodiscard]] SIMCONNECT_DATA_REQUEST_ID requestId() const { return areaRequestId; }
+  [[nodiscard]] ClientDataDirection direction() const { return areaDirection; }
+  [[nodiscard]] virtual DWORD size() const = 0;
+
+  /**
+   * Passes received client data to the handler of the area.
+   * @return false if the message is too short for the area
+   */
+  bool deliver(const SIMCONNECT_RECV_CLIENT_DATA* pClientData, DWORD cbData) const {
+    if (cbData < sizeof(SIMCONNECT_RECV_CLIENT_DATA) - sizeof(DWORD) + size()) {
+      LOGF_WARN_RATE(1, "Received client data too short for {}: {} bytes", name(), cbData);
+      return false;
+    }
+    receive(&pClientData->dwData);
+    return true;
+  }
+
+ protected:
+  ClientDataAreaBase(std::string name,
+                     ClientDataDirection direction,
+                     SIMCONNECT_CLIENT_DATA_ID id,
+                     SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId,
+                     SIMCONNECT_DATA_REQUEST_ID requestId)
+      : areaName(std::move(name)), areaDirection(direction), areaId(id), areaDefinitionId(definitionId), areaRequestId(requestId) {}
+
+  /** Passes the received data to the handler. data points into the SimConnect message and is valid during the call only. */
+  virtual void receive(const void* data) const = 0;
+
+ private:
+  std::string areaName;
+  ClientDataDirection areaDirection;
+  SIMCONNECT_CLIENT_DATA_ID areaId;
+  SIMCONNECT_CLIENT_DATA_DEFINITION_ID areaDefinitionId;
+  SIMCONNECT_DATA_REQUEST_ID areaRequestId;
+};
+
+/**
+ * Client data area holding one value of type T.
+ *
+ * T must be a packed (alignof 1) trivially copyable struct with exactly the size declared as
+ * WireSize so a layout change on our side cannot silently break the protocol with the WASM side.
+ * Received data is handed to the handler as a typed view into the SimConnect message - no copy is
+ * made unless the handler makes one.
+ */
+template <typename T, size_t WireSize = sizeof(T)>
+class ClientDataArea : public ClientDataAreaBase {
+  static_assert(std::is_trivially_copyable_v<T>, "client data must be trivially copyable");
+  static_assert(alignof(T) == 1, "client data must be packed - use __attribute__((packed))");
+  static_assert(sizeof(T) == WireSize, "client data layout does not match the declared wire size");
+  static_assert(sizeof(T) <= SIMCONNECT_CLIENTDATA_MAX_SIZE, "client data exceeds SIMCONNECT_CLIENTDATA_MAX_SIZE");
+
+ public:
+  /** Called with a view of the received data - only valid during the call. */
+  using Handler = std::function<void(const T& data)>;
+
+  ClientDataArea(std::string name,
+                 ClientDataDirection direction,
+                 SIMCONNECT_CLIENT_DATA_ID id,
+                 SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId,
+                 SIMCONNECT_DATA_REQUEST_ID requestId,
+                 Handler handler)
+      : ClientDataAreaBase(std::move(name), direction, id, definitionId, requestId), onReceive(std::move(handler)) {}
+
+  [[nodiscard]] DWORD size() const override { return sizeof(T); }
+
+  /** Writes data to the area. */
+  bool set(HANDLE hSimConnect, const T& data) const {
+    if (!SUCCEEDED(SimConnect_SetClientData(hSimConnect, id(), definitionId(), SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, sizeof(T),
+                                            const_cast<T*>(&data)))) {
+      return false;
+    }
+    trafficCapture->recordSent(id(), definitionId(), &data, sizeof(T));
+    return true;
+  }
+
+  /** Queues a write of data to the area - sent with the next flush of the queue. */
+  void set(SendQueue& sendQueue, const T& data, SendMode mode = SendMode::MERGE, uint32_t mergeKey = 0) const {
+    sendQueue.set(id(), definitionId(), &data, sizeof(T), mode, mergeKey);
+  }
+
+  /** Requests the area content once - it is delivered to the handler. */
+  bool request(HANDLE hSimConnect) const {
+    return SUCCEEDED(
+        SimConnect_RequestClientData(hSimConnect, id(), requestId(), definitionId(), SIMCONNECT_CLIENT_DATA_PERIOD_ONCE));
+  }
+
+ protected:
+  void receive(const void* data) const override {
+    if (onReceive) {
+      onReceive(*static_cast<const T*>(data));
+    }
+  }
+
+ private:
+  Handler onReceive;
+};
+
+/**
+ * Registry of all client data areas of the module.
+ *
+ * Areas are declared once with their type, name and direction. The registry assigns the area,
+ * definition and request IDs and registers all areas with SimConnect in one pass at connect.
+ * Received client data is routed to the areas by the Dispatcher - see ClientDataAreaBase::deliver().
+ *
+ * Usage:
+ *
+ * auto& area = clientDataRegistry().add<ExampleClientData, 27>("EXAMPLE CLIENT DATA", ClientDataDirection::REQUEST,
+ *                                                               [](const ExampleClientData& data) { ... });
+ * clientDataRegistry().registerAll(hSimConnect);  // at connect
+ */
+class ClientDataRegistry {
+ public:
+  /**
+   * @param firstDefinitionId first client data definition ID used by the registry
+   * @param firstRequestId first request ID used by the registry - IDs below are free for other requests
+   */
+  ClientDataRegistry(SIMCONNECT_CLIENT_DATA_DEFINITION_ID firstDefinitionId, SIMCONNECT_DATA_REQUEST_ID firstRequestId)
+      : nextDefinitionId(firstDefinitionId), firstRequest(firstRequestId) {}
+
+  ClientDataRegistry(const ClientDataRegistry&) = delete;
+  ClientDataRegistry& operator=(const ClientDataRegistry&) = delete;
+
+  /** Declares an area. The returned reference stays valid for the lifetime of the registry. */
+  template <typename T, size_t WireSize = sizeof(T)>
+  ClientDataArea<T, WireSize>& add(const std::string& name,
+                                   ClientDataDirection direction,
+                                   typename ClientDataArea<T, WireSize>::Handler handler = nullptr) {
+    const auto id = static_cast<SIMCONNECT_CLIENT_DATA_ID>(areas.size());
+    auto area = std::make_unique<ClientDataArea<T, WireSize>>(name, direction, id, nextDefinitionId++,
+                                                              firstRequest + static_cast<SIMCONNECT_DATA_REQUEST_ID>(areas.size()),
+                                                              std::move(handler));
+    auto& result = *area;
+    areas.push_back(std::move(area));
+    return result;
+  }
+
+  /**
+   * Reserves a block of client data definition IDs for definitions added outside the registry,
+   * e.g. the span and page definitions of partial writes.
+   * @return the first ID of the block
+   */
+  SIMCONNECT_CLIENT_DATA_DEFINITION_ID reserveDefinitionIds(uint32_t count) {
+    const auto first = nextDefinitionId;
+    nextDefinitionId += count;
+    return first;
+  }
+
+  /**
+   * Maps, defines and creates or requests all declared areas.
+   * @return false if any SimConnect call failed - the failures are logged
+   */
+  bool registerAll(HANDLE hSimConnect) const {
+    bool success = true;
+    for (const auto& area : areas) {
+      success &= registerArea(hSimConnect, *area);
+    }
+    return success;
+  }
+
+  /** Calls f for every declared area in declaration order. */
+  template <typename F>
+  void forEach(F&& f) const {
+    for (const auto& area : areas) {
+      f(*area);
+    }
+  }
+
+  [[nodiscard]] size_t size() const { return areas.size(); }
+
+ private:
+  std::vector<std::unique_ptr<ClientDataAreaBase>> areas;
+  SIMCONNECT_CLIENT_DATA_DEFINITION_ID nextDefinitionId;
+  SIMCONNECT_DATA_REQUEST_ID firstRequest;
+
+  static bool registerArea(HANDLE hSimConnect, const ClientDataAreaBase& area) {
+    // Map the client data area name to the client data area ID
+    const HRESULT hresult = SimConnect_MapClientDataNameToID(hSimConnect, area.name().c_str(), area.id());
+    if (hresult != S_OK) {
+      switch (hresult) {
+        case SIMCONNECT_EXCEPTION_ALREADY_CREATED:
+          LOG_ERROR("Client data area already in use: " + area.name());
+          break;
+        case SIMCONNECT_EXCEPTION_DUPLICATE_ID:
+          LOG_ERROR("Client data area ID already in use: " + std::to_string(area.id()));
+          break;
+        default:
+          LOG_ERROR("Mapping client data area " + area.name() + " to ID " + std::to_string(area.id()) + " failed");
+      }
+      return false;
+    }
+
+    // Add the data definition to the client data area
+    if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, area.definitionId(), SIMCONNECT_CLIENTDATAOFFSET_AUTO, area.size()))) {
+      LOG_ERROR("Adding to client data definition failed: " + area.name());
+      return false;
+    }
+
+    switch (area.direction()) {
+      case ClientDataDirection::SEND:
+        // Create/allocate the client data area
+        if (!SUCCEEDED(SimConnect_CreateClientData(hSimConnect, area.id(), area.size(), SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT))) {
+          LOG_ERROR("Creating client data failed: " + area.name());
+          return false;
+        }
+        break;
+      case ClientDataDirection::RECEIVE:
+        // Request the client data area when changed
+        if (!SUCCEEDED(SimConnect_RequestClientData(hSimConnect, area.id(), area.requestId(), area.definitionId(),
+                                                    SIMCONNECT_CLIENT_DATA_PERIOD_ON_SET))) {
+          LOG_ERROR("Requesting client data failed: " + area.name());
+          return false;
+        }
+        break;
+      case ClientDataDirection::REQUEST:
+        break;
+    }
+    return true;
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_CLIENTDATAAREA_H
@@ -0,0 +1,210 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_CLIENTDATADELTA_H
+#define FBW_CPP_FRAMEWORK_TEST_CLIENTDATADELTA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "SimConnect.h"
+#include "sendqueue.h"
+#include "trafficcapture.h"
+
+/**
+ * A range of pages of a client data area.
+ */
+struct PageRange {
+  uint32_t firstPage;
+  uint32_t pageCount;
+};
+
+/**
+ * Tracks which pages of a client data area have changed since the last write.
+ *
+ * Changes are found by comparing the data with a shadow copy of what was last written, so the
+ * owner of the data does not need to report its writes. Dirty pages are coalesced into ranges:
+ * runs separated by at most maxGapPages clean pages are merged, as rewriting a few clean pages is
+ * cheaper than an additional SimConnect call.
+ */
+class DirtyPageTracker {
+ public:
+  DirtyPageTracker(size_t areaSize, uint32_t pageSize, uint32_t maxGapPages)
+      : size(areaSize), page(pageSize), maxGap(maxGapPages), shadow(areaSize, 0), dirty((areaSize + pageSize - 1) / pageSize, 0) {}
+
+  /** Marks all pages dirty - e.g. when the area content on the sim side is unknown. */
+  void invalidate() { std::fill(dirty.begin(), dirty.end(), 1); }
+
+  /** Compares data with the last written content and marks the changed pages dirty. */
+  void scan(const void* data) {
+    const auto* const p = static_cast<const char*>(data);
+    for (size_t i = 0; i < dirty.size(); i++) {
+      const size_t offset = i * page;
+      if (!dirty[i] && std::memcmp(p + offset, shadow.data() + offset, pageBytes(static_cast<uint32_t>(i), 1)) != 0) {
+        dirty[i] = 1;
+      }
+    }
+  }
+
+  /** @return the coalesced dirty page ranges in ascending order */
+  [[nodiscard]] std::vector<PageRange> dirtyRanges() const {
+    std::vector<PageRange> ranges;
+    for (uint32_t i = 0; i < dirty.size(); i++) {
+      if (!dirty[i]) {
+        continue;
+      }
+      if (!ranges.empty() && i - (ranges.back().firstPage + ranges.back().pageCount) <= maxGap) {
+        ranges.back().pageCount = i - ranges.back().firstPage + 1;
+      } else {
+        ranges.push_back({i, 1});
+      }
+    }
+    return ranges;
+  }
+
+  /** Records the given range of data as written and clears its dirty flags. */
+  void markWritten(const void* data, PageRange range) {
+    const size_t offset = range.firstPage * page;
+    std::memcpy(shadow.data() + offset, static_cast<const char*>(data) + offset, pageBytes(range.firstPage, range.pageCount));
+    std::fill_n(dirty.begin() + range.firstPage, range.pageCount, 0);
+  }
+
+  /** @return the number of bytes of a range - the last page of the area may be shorter than pageSize */
+  [[nodiscard]] DWORD pageBytes(uint32_t firstPage, uint32_t pageCount) const {
+    const size_t offset = firstPage * page;
+    return static_cast<DWORD>(std::min<size_t>(pageCount * page, size - offset));
+  }
+
+  [[nodiscard]] uint32_t pageSize() const { return page; }
+  [[nodiscard]] uint32_t pageCount() const { return static_cast<uint32_t>(dirty.size()); }
+
+ private:
+  size_t size;
+  uint32_t page;
+  uint32_t maxGap;
+  std::vector<char> shadow;
+  std::vector<char> dirty;
+};
+
+/**
+ * Writes only the changed page ranges of a client data area instead of the whole area.
+ *
+ * SimConnect_SetClientData has no offset parameter - the offset of a write is taken from the
+ * client data definition. Each page has one definition starting at it, added on first use with the
+ * length of the range written then. A later range starting at the same page writes that length -
+ * a shorter range rewrites a few clean pages, a longer one is continued with the definition of the
+ * page after. A definition is never changed while writes using it may still be queued. Definition
+ * IDs firstDefinitionId .. firstDefinitionId + pageCount - 1 must be reserved for this writer.
+ *
+ * The first write after construction or invalidate() writes the whole area with the area's own
+ * definition.
+ *
+ * Usage:
+ *
+ * ClientDataDeltaWriter writer(BIG_CLIENT_DATA_ID, BIG_CLIENT_DATA_DEFINITION_ID, BIG_CLIENT_DATA_PAGE_DEFINITION_ID,
+ *                              sizeof(bigClientData), 512, 1);
+ * writer.write(hSimConnect, &bigClientData);  // in every update - only sends what changed
+ */
+class ClientDataDeltaWriter {
+ public:
+  /**
+   * @param areaDefinitionId definition of the whole area - used when all pages are written
+   * @param firstDefinitionId first of pageCount reserved definition IDs for the page ranges
+   */
+  ClientDataDeltaWriter(SIMCONNECT_CLIENT_DATA_ID clientDataId,
+                        SIMCONNECT_CLIENT_DATA_DEFINITION_ID areaDefinitionId,
+                        SIMCONNECT_CLIENT_DATA_DEFINITION_ID firstDefinitionId,
+                        size_t areaSize,
+                        uint32_t pageSize,
+                        uint32_t maxGapPages)
+      : areaId(clientDataId), areaDefinition(areaDefinitionId), firstDefinition(firstDefinitionId), tracker(areaSize, pageSize, maxGapPages) {
+    definedPages.assign(tracker.pageCount(), 0);
+    tracker.invalidate();
+  }
+
+  /** Forces the next write() to send the whole area and to add the range definitions again - call after reconnecting to the sim. */
+  void invalidate() {
+    tracker.invalidate();
+    std::fill(definedPages.begin(), definedPages.end(), 0);
+  }
+
+  /** Forces the next write() to send the whole area - call when a queued write failed, see SendQueue::onFailed(). */
+  void markStale() { tracker.invalidate(); }
+
+  /**
+   * Sends the changed ranges of data to the client data area.
+   * @param sendQueue if given the ranges are queued there instead of sent right away - they count as written once queued,
+   *                  a failed queued write has to be reported with markStale()
+   * @return false if a SimConnect call failed - the failed ranges stay dirty and are retried with the next write
+   */
+  bool write(HANDLE hSimConnect, const void* data, SendQueue* sendQueue = nullptr) {
+    tracker.scan(data);
+    const auto ranges = tracker.dirtyRanges();
+    if (ranges.empty()) {
+      skippedWrites++;
+    }
+    for (const auto dirtyRange : ranges) {
+      if (dirtyRange.pageCount == tracker.pageCount()) {
+        if (!writeRange(hSimConnect, data, sendQueue, areaDefinition, dirtyRange)) {
+          return false;
+        }
+        continue;
+      }
+      // split the range along the lengths the page definitions were added with
+      uint32_t page = dirtyRange.firstPage;
+      const uint32_t end = dirtyRange.firstPage + dirtyRange.pageCount;
+      while (page < end) {
+        if (!definedPages[page]) {
+          if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, firstDefinition + page, page * tracker.pageSize(),
+                                                              tracker.pageBytes(page, end - page)))) {
+            return false;
+          }
+          definedPages[page] = end - page;
+        }
+        const PageRange range{page, definedPages[page]};
+        if (!writeRange(hSimConnect, data, sendQueue, firstDefinition + page, range)) {
+          return false;
+        }
+        page += range.pageCount;
+      }
+    }
+    return true;
+  }
+
+  /** @return the number of definition IDs used from firstDefinitionId on */
+  [[nodiscard]] uint32_t definitionIdCount() const { return static_cast<uint32_t>(definedPages.size()); }
+  [[nodiscard]] uint64_t rangeWriteCount() const { return rangeWrites; }
+  [[nodiscard]] uint64_t skippedWriteCount() const { return skippedWrites; }
+  [[nodiscard]] uint64_t writtenBytes() const { return bytesWritten; }
+
+ private:
+  SIMCONNECT_CLIENT_DATA_ID areaId;
+  SIMCONNECT_CLIENT_DATA_DEFINITION_ID areaDefinition;
+  SIMCONNECT_CLIENT_DATA_DEFINITION_ID firstDefinition;
+  DirtyPageTracker tracker;
+  std::vector<uint32_t> definedPages;  // page count of the definition starting at each page - 0 if not added yet
+  uint64_t rangeWrites = 0;
+  uint64_t skippedWrites = 0;
+  uint64_t bytesWritten = 0;
+
+  bool writeRange(HANDLE hSimConnect, const void* data, SendQueue* sendQueue, SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId, PageRange range) {
+    const DWORD size = tracker.pageBytes(range.firstPage, range.pageCount);
+    const auto* const src = static_cast<const char*>(data) + range.firstPage * tracker.pageSize();
+    if (sendQueue != nullptr) {
+      sendQueue->set(areaId, definitionId, src, size);
+    } else if (!SUCCEEDED(SimConnect_SetClientData(hSimConnect, areaId, definitionId, SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, size,
+                                                   const_cast<char*>(src)))) {
+      return false;
+    } else {
+      trafficCapture->recordSent(areaId, definitionId, src, size);
+    }
+    tracker.markWritten(data, range);
+    rangeWrites++;
+    bytesWritten += size;
+    return true;
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_CLIENTDATADELTA_H
@@ -0,0 +1,201 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_COMPRESSION_H
+#define FBW_CPP_FRAMEWORK_TEST_COMPRESSION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Compression applied to stream data before it is cut into chunks.
+ * The value is transferred in StreamMetaData so the receiver knows how to restore the data.
+ * All formats are standard so the WASM side can use any conforming implementation.
+ */
+enum class StreamCompression : uint32_t {
+  /** data is sent as is */
+  NONE = 0,
+  /** LZ4 block format (no frame header) - fast enough to not be noticeable next to the SimConnect transfer */
+  LZ4 = 1,
+};
+
+namespace compression_detail {
+
+constexpr size_t LZ4_MIN_MATCH = 4;
+constexpr size_t LZ4_LAST_LITERALS = 5;   // the last 5 bytes of a block are always literals
+constexpr size_t LZ4_MATCH_FIND_LIMIT = 12;  // the last match must start at least 12 bytes before the end
+constexpr size_t LZ4_MAX_OFFSET = 65535;
+constexpr int LZ4_HASH_LOG = 12;
+constexpr int LZ4_SKIP_TRIGGER = 6;  // search step grows by one every 2^6 failed attempts on incompressible data
+
+inline uint32_t read32(const unsigned char* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+constexpr uint32_t lz4Hash(uint32_t sequence) {
+  return (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+inline void lz4WriteLength(std::vector<char>& out, size_t length) {
+  for (length -= 15; length >= 255; length -= 255) {
+    out.push_back(static_cast<char>(255));
+  }
+  out.push_back(static_cast<char>(length));
+}
+
+/** Appends one sequence - literals followed by an optional match (matchLength 0 = last sequence). */
+inline void lz4WriteSequence(std::vector<char>& out, const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength) {
+  const size_t matchCode = matchLength > 0 ? matchLength - LZ4_MIN_MATCH : 0;
+  const auto token = static_cast<unsigned char>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+  out.push_back(static_cast<char>(token));
+  if (literalLength >= 15) {
+    lz4WriteLength(out, literalLength);
+  }
+  out.insert(out.end(), literals, literals + literalLength);
+  if (matchLength == 0) {
+    return;
+  }
+  out.push_back(static_cast<char>(offset & 0xFF));
+  out.push_back(static_cast<char>(offset >> 8));
+  if (matchCode >= 15) {
+    lz4WriteLength(out, matchCode);
+  }
+}
+
+inline std::vector<char> lz4Compress(const unsigned char* src, size_t size) {
+  std::vector<char> out;
+  out.reserve(size + size / 255 + 16);
+  size_t anchor = 0;
+  if (size > LZ4_MATCH_FIND_LIMIT) {
+    std::vector<uint32_t> table(size_t{1} << LZ4_HASH_LOG, 0);
+    const size_t matchLimit = size - LZ4_LAST_LITERALS;
+    const size_t searchLimit = size - LZ4_MATCH_FIND_LIMIT;
+    size_t pos = 1;
+    uint32_t attempts = 1U << LZ4_SKIP_TRIGGER;
+    table[lz4Hash(read32(src))] = 0;
+    while (pos < searchLimit) {
+      const uint32_t sequence = read32(src + pos);
+      const uint32_t hash = lz4Hash(sequence);
+      const size_t candidate = table[hash];
+      table[hash] = static_cast<uint32_t>(pos);
+      if (pos - candidate > LZ4_MAX_OFFSET || read32(src + candidate) != sequence) {
+        pos += attempts++ >> LZ4_SKIP_TRIGGER;
+        continue;
+      }
+      size_t matchLength = LZ4_MIN_MATCH;
+      while (pos + matchLength < matchLimit && src[candidate + matchLength] == src[pos + matchLength]) {
+        matchLength++;
+      }
+      lz4WriteSequence(out, src + anchor, pos - anchor, pos - candidate, matchLength);
+      pos += matchLength;
+      anchor = pos;
+      attempts = 1U << LZ4_SKIP_TRIGGER;
+      if (pos < searchLimit) {
+        // keep the position just before the next search start in the table to catch adjacent repeats
+        table[lz4Hash(read32(src + pos - 2))] = static_cast<uint32_t>(pos - 2);
+      }
+    }
+  }
+  lz4WriteSequence(out, src + anchor, size - anchor, 0, 0);
+  return out;
+}
+
+inline bool lz4Decompress(const unsigned char* src, size_t size, unsigned char* dst, size_t dstSize) {
+  size_t in = 0;
+  size_t out = 0;
+  const auto readLength = [&](size_t& length) {
+    unsigned char b = 255;
+    while (b == 255) {
+      if (in >= size) {
+        return false;
+      }
+      b = src[in++];
+      length += b;
+    }
+    return true;
+  };
+  while (in < size) {
+    const unsigned char token = src[in++];
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !readLength(literalLength)) {
+      return false;
+    }
+    if (literalLength > size - in || literalLength > dstSize - out) {
+      return false;
+    }
+    std::memcpy(dst + out, src + in, literalLength);
+    in += literalLength;
+    out += literalLength;
+    if (in == size) {
+      break;  // last sequence has no match
+    }
+    if (size - in < 2) {
+      return false;
+    }
+    const size_t offset = src[in] | (src[in + 1] << 8);
+    in += 2;
+    size_t matchLength = token & 0x0F;
+    if (matchLength == 15 && !readLength(matchLength)) {
+      return false;
+    }
+    matchLength += LZ4_MIN_MATCH;
+    if (offset == 0 || offset > out || matchLength > dstSize - out) {
+      return false;
+    }
+    // matches may overlap their own output (offset < matchLength) - copy forward byte by byte then
+    const unsigned char* match = dst + out - offset;
+    if (offset >= matchLength) {
+      std::memcpy(dst + out, match, matchLength);
+    } else {
+      for (size_t i = 0; i < matchLength; i++) {
+        dst[out + i] = match[i];
+      }
+    }
+    out += matchLength;
+  }
+  return out == dstSize;
+}
+
+}  // namespace compression_detail
+
+/**
+ * Compresses data with the given compression.
+ * @return the compressed data - a copy of the data for StreamCompression::NONE
+ */
+inline std::vector<char> compress(const void* data, size_t size, StreamCompression compression) {
+  const auto* p = static_cast<const unsigned char*>(data);
+  switch (compression) {
+    case StreamCompression::LZ4:
+      return compression_detail::lz4Compress(p, size);
+    case StreamCompression::NONE:
+    default:
+      return {p, p + size};
+  }
+}
+
+/**
+ * Restores data compressed with compress().
+ * @param out must have room for exactly outSize bytes - the original size transferred in the meta data
+ * @return false if the data is corrupt or does not restore to exactly outSize bytes
+ */
+inline bool decompress(const void* data, size_t size, void* out, size_t outSize, StreamCompression compression) {
+  const auto* p = static_cast<const unsigned char*>(data);
+  switch (compression) {
+    case StreamCompression::LZ4:
+      return compression_detail::lz4Decompress(p, size, static_cast<unsigned char*>(out), outSize);
+    case StreamCompression::NONE:
+      if (size != outSize) {
+        return false;
+      }
+      std::memcpy(out, data, size);
+      return true;
+    default:
+      return false;
+  }
+}
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_COMPRESSION_H
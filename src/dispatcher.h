@@ -0,0 +1,204 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_DISPATCHER_H
+#define FBW_CPP_FRAMEWORK_TEST_DISPATCHER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SimConnect.h"
+
+/**
+ * Table driven dispatcher for SimConnect messages.
+ *
+ * Handlers are kept in flat arrays - one handler per message kind (SIMCONNECT_RECV_ID) and one per
+ * request ID of keyed kinds (client data, sim object data, events). Dispatching is an array lookup
+ * in both cases. A keyed handler takes precedence over the kind handler of the same kind.
+ * Handlers can be added, replaced and removed at any time, e.g. for client data areas created at
+ * runtime. A handler which replaces or removes itself keeps running - the change takes effect when
+ * it returns.
+ *
+ * Every handler records its call count and the cumulative and maximum time spent in it.
+ *
+ * Usage:
+ *
+ * dispatcher.on(SIMCONNECT_RECV_ID_QUIT, "quit", [](const SIMCONNECT_RECV*, DWORD) { quit = 1; });
+ * dispatcher.onRequest(SIMCONNECT_RECV_ID_CLIENT_DATA, requestId, "EXAMPLE", [](const SIMCONNECT_RECV* p, DWORD size) { ... });
+ * dispatcher.dispatch(pRecv, cbData);
+ */
+class Dispatcher {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Handler = std::function<void(const SIMCONNECT_RECV* pRecv, DWORD cbData)>;
+
+  /** Statistics of one handler. */
+  struct HandlerStats {
+    std::string name;
+    uint64_t calls = 0;
+    Clock::duration total{};
+    Clock::duration max{};
+  };
+
+  /** Sets the handler for all messages of a kind. Replaces an existing handler. */
+  void on(SIMCONNECT_RECV_ID kind, std::string name, Handler handler) { set(slot(kindSlots, kind), std::move(name), std::move(handler)); }
+
+  /** Sets the handler for messages of a keyed kind with the given request ID (event ID for events). Replaces an existing handler. */
+  void onRequest(SIMCONNECT_RECV_ID kind, DWORD requestId, std::string name, Handler handler) {
+    set(slot(slot(requestSlots, kind), requestId), std::move(name), std::move(handler));
+  }
+
+  /** Removes the handler for a kind. */
+  void remove(SIMCONNECT_RECV_ID kind) {
+    if (kind < kindSlots.size()) {
+      clear(kindSlots[kind]);
+    }
+  }
+
+  /** Removes the handler for a request ID of a keyed kind. */
+  void removeRequest(SIMCONNECT_RECV_ID kind, DWORD requestId) {
+    if (kind < requestSlots.size() && requestId < requestSlots[kind].size()) {
+      clear(requestSlots[kind][requestId]);
+    }
+  }
+
+  /**
+   * Calls the handler for the message.
+   * @return false if there is no handler - the message is counted as unhandled
+   */
+  bool dispatch(const SIMCONNECT_RECV* pRecv, DWORD cbData) {
+    const DWORD kind = pRecv->dwID;
+    const DWORD key = requestKey(pRecv);
+    Slot* target = find(kind, key);
+    if (target == nullptr) {
+      unhandled++;
+      return false;
+    }
+    const auto start = Clock::now();
+    running = target;
+    target->handler(pRecv, cbData);
+    running = nullptr;
+    const auto elapsed = Clock::now() - start;
+    target->stats.calls++;
+    target->stats.total += elapsed;
+    target->stats.max = std::max(target->stats.max, elapsed);
+    if (target->replacement) {
+      *target = {std::move(target->replacement), {std::move(target->replacementName)}};
+    } else if (target->removed) {
+      clear(*target);
+    }
+    return true;
+  }
+
+  /** @return the statistics of all registered handlers which have been called, most total time first */
+  [[nodiscard]] std::vector<HandlerStats> stats() const {
+    std::vector<HandlerStats> result;
+    const auto collect = [&result](const std::deque<Slot>& slots) {
+      for (const auto& s : slots) {
+        if (s.handler && !s.removed && s.stats.calls > 0) {
+          result.push_back(s.stats);
+        }
+      }
+    };
+    collect(kindSlots);
+    for (const auto& slots : requestSlots) {
+      collect(slots);
+    }
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.total > b.total; });
+    return result;
+  }
+
+  /** Resets the statistics of all handlers. */
+  void resetStats() {
+    const auto reset = [](std::deque<Slot>& slots) {
+      for (auto& s : slots) {
+        s.stats = {std::move(s.stats.name)};
+      }
+    };
+    reset(kindSlots);
+    for (auto& slots : requestSlots) {
+      reset(slots);
+    }
+    unhandled = 0;
+  }
+
+  /** @return number of messages without a handler */
+  [[nodiscard]] uint64_t unhandledCount() const { return unhandled; }
+
+ private:
+  struct Slot {
+    Handler handler;
+    HandlerStats stats;
+    bool removed = false;  // removed by its own handler - cleared after the call returns
+    // set by its own handler - takes the place of handler after the call returns
+    Handler replacement{};
+    std::string replacementName{};
+  };
+
+  // deques keep slots in place when growing so handlers can add handlers while being called
+  std::deque<Slot> kindSlots;
+  std::deque<std::deque<Slot>> requestSlots;
+  Slot* running = nullptr;
+  uint64_t unhandled = 0;
+
+  void set(Slot& s, std::string name, Handler handler) {
+    if (&s == running) {
+      // destroying the running handler would destroy the code being executed
+      s.replacement = std::move(handler);
+      s.replacementName = std::move(name);
+      s.removed = false;
+      return;
+    }
+    s = {std::move(handler), {std::move(name)}};
+  }
+
+  void clear(Slot& s) {
+    if (&s == running) {
+      s.removed = true;
+      s.replacement = nullptr;
+      return;
+    }
+    s = {};
+  }
+
+  Slot* find(DWORD kind, DWORD key) {
+    if (kind < requestSlots.size() && key < requestSlots[kind].size() && requestSlots[kind][key].handler) {
+      return &requestSlots[kind][key];
+    }
+    if (kind < kindSlots.size() && kindSlots[kind].handler) {
+      return &kindSlots[kind];
+    }
+    return nullptr;
+  }
+
+  template <typename T>
+  static T& slot(std::deque<T>& slots, DWORD index) {
+    if (index >= slots.size()) {
+      slots.resize(index + 1);
+    }
+    return slots[index];
+  }
+
+  /** @return the ID keyed handlers are registered with - request ID for data, event ID for events */
+  static DWORD requestKey(const SIMCONNECT_RECV* pRecv) {
+    switch (pRecv->dwID) {
+      case SIMCONNECT_RECV_ID_EVENT:
+        return static_cast<const SIMCONNECT_RECV_EVENT*>(pRecv)->uEventID;
+      case SIMCONNECT_RECV_ID_SIMOBJECT_DATA:
+      case SIMCONNECT_RECV_ID_CLIENT_DATA:
+        return static_cast<const SIMCONNECT_RECV_SIMOBJECT_DATA*>(pRecv)->dwRequestID;
+      case SIMCONNECT_RECV_ID_SYSTEM_STATE:
+        return static_cast<const SIMCONNECT_RECV_SYSTEM_STATE*>(pRecv)->dwRequestID;
+      default:
+        return static_cast<DWORD>(-1);
+    }
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_DISPATCHER_H
@@ -0,0 +1,159 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_FILESTREAM_H
+#define FBW_CPP_FRAMEWORK_TEST_FILESTREAM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+
+#include "fingerprint.h"
+#include "mappedfile.h"
+#include "streamsink.h"
+
+/**
+ * File sent as a stream straight from a memory mapping.
+ *
+ * The sender reports the offset it reads with advance(). The source then reads readAheadBytes ahead
+ * and evicts what lies more than readAheadBytes behind - retransmitted chunks are read from the file
+ * again. Only about twice readAheadBytes of the file are in memory at any time.
+ *
+ * Usage:
+ *
+ * FileSource source(4 * 1024 * 1024);
+ * source.open("data.bin");
+ * const uint64_t hash = source.fingerprint(algorithm);
+ * source.advance(offset);  // before reading each chunk
+ */
+class FileSource {
+ public:
+  explicit FileSource(size_t readAheadBytes) : readAhead(readAheadBytes) {}
+
+  /** @return false if the file could not be opened or mapped */
+  bool open(const std::string& path) {
+    prefetchedFrom = 0;
+    prefetchedTo = 0;
+    return file.openRead(path);
+  }
+
+  [[nodiscard]] bool isOpen() const { return file.isOpen(); }
+  [[nodiscard]] std::span<const char> data() const { return {file.data(), file.size()}; }
+
+  /** Reads ahead of offset and evicts the range far behind it - offset may also jump back, e.g. for a new transfer. */
+  void advance(size_t offset) {
+    if (offset >= prefetchedFrom && offset + readAhead / 2 < prefetchedTo) {
+      return;
+    }
+    file.prefetch(offset, readAhead);
+    prefetchedFrom = offset;
+    prefetchedTo = offset + readAhead;
+    if (offset > readAhead) {
+      file.evict(0, offset - readAhead);
+    }
+  }
+
+  /** @return the flat fingerprint of the file - computed in one sequential pass with constant memory */
+  uint64_t fingerprint(FingerprintAlgorithm algorithm) {
+    Fingerprinter hasher(algorithm);
+    const auto content = data();
+    for (size_t offset = 0; offset < content.size(); offset += readAhead) {
+      advance(offset);
+      hasher.update(content.data() + offset, std::min(readAhead, content.size() - offset));
+    }
+    file.evict(0, content.size());
+    prefetchedFrom = 0;
+    prefetchedTo = 0;
+    return hasher.digest();
+  }
+
+ private:
+  MappedFile file;
+  size_t readAhead;
+  // range read ahead by the last advance()
+  size_t prefetchedFrom = 0;
+  size_t prefetchedTo = 0;
+};
+
+/**
+ * Stream sink writing into a sparse memory-mapped file.
+ *
+ * Every flushBytes of received data the written range is flushed to the file and evicted from memory,
+ * so receiving a stream larger than the available memory keeps the memory use constant. The file is
+ * created when the stream starts and closed when it ends - an incomplete stream leaves a file with
+ * holes.
+ *
+ * Usage:
+ *
+ * FileSink sink("received.bin", 8 * 1024 * 1024);
+ * demultiplexer.setSink(streamId, &sink);
+ */
+class FileSink : public StreamSink {
+ public:
+  FileSink(std::string path, size_t flushBytes) : filePath(std::move(path)), flushEvery(flushBytes) {}
+
+  std::span<char> open([[maybe_unused]] const StreamMetaData& metaData, size_t size) override {
+    resetDirty();
+    bytes = 0;
+    streamSize = size;
+    complete = false;
+    if (!file.create(filePath, size)) {
+      return {};
+    }
+    return {file.data(), size};
+  }
+
+  void written(size_t offset, size_t size) override {
+    bytes += size;
+    dirtyBegin = std::min(dirtyBegin, offset);
+    dirtyEnd = std::max(dirtyEnd, offset + size);
+    if (dirtyEnd - dirtyBegin >= flushEvery) {
+      flush();
+    }
+  }
+
+  void close(bool completed) override {
+    flush();
+    file.close();
+    complete = completed;
+  }
+
+  [[nodiscard]] const std::string& path() const { return filePath; }
+  /** @return true while a stream is written to the file */
+  [[nodiscard]] bool isReceiving() const { return file.isOpen(); }
+  /** @return true if the last stream was received completely */
+  [[nodiscard]] bool isComplete() const { return complete; }
+  /** @return bytes of the current or last stream written so far */
+  [[nodiscard]] size_t writtenBytes() const { return bytes; }
+  /** @return size of the current or last stream */
+  [[nodiscard]] size_t size() const { return streamSize; }
+
+ private:
+  MappedFile file;
+  std::string filePath;
+  size_t flushEvery;
+  size_t bytes = 0;
+  size_t streamSize = 0;
+  bool complete = false;
+  // range written since the last flush
+  size_t dirtyBegin = SIZE_MAX;
+  size_t dirtyEnd = 0;
+
+  void flush() {
+    if (dirtyEnd > dirtyBegin) {
+      file.flush(dirtyBegin, dirtyEnd - dirtyBegin);
+      file.evict(dirtyBegin, dirtyEnd - dirtyBegin);
+    }
+    resetDirty();
+  }
+
+  void resetDirty() {
+    dirtyBegin = SIZE_MAX;
+    dirtyEnd = 0;
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_FILESTREAM_H
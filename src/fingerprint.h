@@ -5,10 +5,432 @@
 #ifndef FBW_CPP_FRAMEWORK_TEST_FINGERPRINT_H
 #define FBW_CPP_FRAMEWORK_TEST_FINGERPRINT_H
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <cstring>
+#include <ranges>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <nmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#define FINGERPRINT_X86_CRC32C
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define FINGERPRINT_ARM_CRC32C
+#endif
+
+/**
+ * Algorithms available for fingerprinting stream data.
+ * The value is transferred in StreamMetaData so sender and receiver agree on the algorithm.
+ * All algorithms are standard so the WASM side can use any conforming implementation.
+ */
+enum class FingerprintAlgorithm : uint32_t {
+  /** legacy byte-wise FNV-1a fold - identical to fingerPrintFVN() on char data */
+  FNV1A = 0,
+  /** XXH64 with seed 0 - 4 independent 64-bit lanes, portable and fast everywhere incl. WASM */
+  XXH64 = 1,
+  /** CRC32C (Castagnoli) - uses SSE4.2 / ARMv8 CRC instructions when available */
+  CRC32C = 2,
+};
+
+constexpr FingerprintAlgorithm DefaultFingerprintAlgorithm = FingerprintAlgorithm::XXH64;
+
+namespace fingerprint_detail {
+
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001b3;
+
+constexpr uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t read64(const unsigned char* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+constexpr uint64_t rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// ==============================
+// FNV-1a (legacy)
+
+inline uint64_t fnv1a(const unsigned char* p, size_t size) {
+  uint64_t fp = 0;
+  for (size_t i = 0; i < size; i++) {
+    fp ^= (FNV_OFFSET_BASIS ^ p[i]) * FNV_PRIME;
+    fp *= FNV_PRIME;
+  }
+  return fp;
+}
+
+// ==============================
+// XXH64
+
+constexpr uint64_t xxhRound(uint64_t acc, uint64_t input) {
+  acc += input * XXH_PRIME64_2;
+  acc = rotl64(acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+constexpr uint64_t xxhMergeRound(uint64_t acc, uint64_t val) {
+  acc ^= xxhRound(0, val);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+inline uint64_t xxh64(const unsigned char* p, size_t size, uint64_t seed = 0) {
+  const unsigned char* const end = p + size;
+  uint64_t h;
+  if (size >= 32) {
+    // four independent lanes keep the multipliers busy instead of one serial dependency chain
+    uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+    uint64_t v2 = seed + XXH_PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - XXH_PRIME64_1;
+    const unsigned char* const limit = end - 32;
+    do {
+      v1 = xxhRound(v1, read64(p));
+      v2 = xxhRound(v2, read64(p + 8));
+      v3 = xxhRound(v3, read64(p + 16));
+      v4 = xxhRound(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    h = xxhMergeRound(h, v1);
+    h = xxhMergeRound(h, v2);
+    h = xxhMergeRound(h, v3);
+    h = xxhMergeRound(h, v4);
+  } else {
+    h = seed + XXH_PRIME64_5;
+  }
+  h += static_cast<uint64_t>(size);
+
+  while (p + 8 <= end) {
+    h ^= xxhRound(0, read64(p));
+    h = rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(read32(p)) * XXH_PRIME64_1;
+    h = rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= static_cast<uint64_t>(*p) * XXH_PRIME64_5;
+    h = rotl64(h, 11) * XXH_PRIME64_1;
+    p++;
+  }
+
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+// ==============================
+// CRC32C
+
+// slice-by-8 tables for the portable fallback
+inline const std::array<std::array<uint32_t, 256>, 8>& crc32cTables() {
+  static const auto tables = [] {
+    std::array<std::array<uint32_t, 256>, 8> t{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int k = 0; k < 8; k++) {
+        crc = (crc >> 1) ^ (0x82F63B78U & (0U - (crc & 1U)));
+      }
+      t[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+      for (size_t s = 1; s < 8; s++) {
+        t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+      }
+    }
+    return t;
+  }();
+  return tables;
+}
+
+inline uint32_t crc32cScalar(uint32_t crc, const unsigned char* p, size_t size) {
+  const auto& t = crc32cTables();
+  while (size >= 8) {
+    const uint64_t v = read64(p) ^ crc;
+    crc = t[7][v & 0xFF] ^ t[6][(v >> 8) & 0xFF] ^ t[5][(v >> 16) & 0xFF] ^ t[4][(v >> 24) & 0xFF] ^ t[3][(v >> 32) & 0xFF] ^
+          t[2][(v >> 40) & 0xFF] ^ t[1][(v >> 48) & 0xFF] ^ t[0][v >> 56];
+    p += 8;
+    size -= 8;
+  }
+  while (size-- > 0) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+  }
+  return crc;
+}
+
+#if defined(FINGERPRINT_X86_CRC32C)
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+inline uint32_t crc32cHardware(uint32_t crc, const unsigned char* p, size_t size) {
+  uint64_t c = crc;
+  while (size >= 8) {
+    c = _mm_crc32_u64(c, read64(p));
+    p += 8;
+    size -= 8;
+  }
+  auto c32 = static_cast<uint32_t>(c);
+  while (size-- > 0) {
+    c32 = _mm_crc32_u8(c32, *p++);
+  }
+  return c32;
+}
+
+inline bool hasHardwareCrc32c() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  static const bool supported = [] {
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+  }();
+  return supported;
+#else
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+#endif
+}
+#elif defined(FINGERPRINT_ARM_CRC32C)
+inline uint32_t crc32cHardware(uint32_t crc, const unsigned char* p, size_t size) {
+  while (size >= 8) {
+    crc = __crc32cd(crc, read64(p));
+    p += 8;
+    size -= 8;
+  }
+  while (size-- > 0) {
+    crc = __crc32cb(crc, *p++);
+  }
+  return crc;
+}
+
+inline bool hasHardwareCrc32c() {
+  return true;
+}
+#else
+inline uint32_t crc32cHardware(uint32_t crc, const unsigned char* p, size_t size) {
+  return crc32cScalar(crc, p, size);
+}
+
+inline bool hasHardwareCrc32c() {
+  return false;
+}
+#endif
+
+inline uint32_t crc32c(const unsigned char* p, size_t size) {
+  const uint32_t crc = hasHardwareCrc32c() ? crc32cHardware(~0U, p, size) : crc32cScalar(~0U, p, size);
+  return ~crc;
+}
+
+}  // namespace fingerprint_detail
+
+/**
+ * Fingerprints a block of memory with the given algorithm.
+ * @param data pointer to the first byte
+ * @param size number of bytes
+ * @param algorithm the algorithm to use
+ * @return the fingerprint - CRC32C values occupy the lower 32 bits
+ */
+inline uint64_t fingerprint(const void* data, size_t size, FingerprintAlgorithm algorithm = DefaultFingerprintAlgorithm) {
+  const auto* p = static_cast<const unsigned char*>(data);
+  switch (algorithm) {
+    case FingerprintAlgorithm::FNV1A:
+      return fingerprint_detail::fnv1a(p, size);
+    case FingerprintAlgorithm::CRC32C:
+      return fingerprint_detail::crc32c(p, size);
+    case FingerprintAlgorithm::XXH64:
+    default:
+      return fingerprint_detail::xxh64(p, size);
+  }
+}
+
+/**
+ * Fingerprints any contiguous range (std::vector, std::array, std::string, std::span, ...) as raw bytes.
+ */
+template <std::ranges::contiguous_range R>
+uint64_t fingerprint(const R& range, FingerprintAlgorithm algorithm = DefaultFingerprintAlgorithm) {
+  return fingerprint(std::ranges::data(range), std::ranges::size(range) * sizeof(std::ranges::range_value_t<R>), algorithm);
+}
+
+/**
+ * Incremental fingerprint state for data arriving in pieces (e.g. stream chunks).
+ * Feeding the data in any split with update() yields the same digest as fingerprint() over the whole data,
+ * so a receiver can hash each chunk while it is still hot in cache and compare in O(1) at the end.
+ *
+ * Usage:
+ *
+ * Fingerprinter hasher(metaData.algorithm);
+ * hasher.update(chunk, chunkSize);   // per chunk
+ * const bool match = hasher.digest() == metaData.hash;
+ */
+class Fingerprinter {
+ public:
+  explicit Fingerprinter(FingerprintAlgorithm algorithm = DefaultFingerprintAlgorithm) { reset(algorithm); }
+
+  /** Restarts the fingerprint with the given algorithm. */
+  void reset(FingerprintAlgorithm algorithm = DefaultFingerprintAlgorithm) {
+    using namespace fingerprint_detail;
+    algo = algorithm;
+    totalSize = 0;
+    bufferSize = 0;
+    fnv = 0;
+    crc = ~0U;
+    v1 = XXH_PRIME64_1 + XXH_PRIME64_2;
+    v2 = XXH_PRIME64_2;
+    v3 = 0;
+    v4 = 0 - XXH_PRIME64_1;
+  }
+
+  /** Adds the next size bytes of the data. */
+  void update(const void* data, size_t size) {
+    using namespace fingerprint_detail;
+    const auto* p = static_cast<const unsigned char*>(data);
+    totalSize += size;
+    switch (algo) {
+      case FingerprintAlgorithm::FNV1A:
+        for (size_t i = 0; i < size; i++) {
+          fnv ^= (FNV_OFFSET_BASIS ^ p[i]) * FNV_PRIME;
+          fnv *= FNV_PRIME;
+        }
+        return;
+      case FingerprintAlgorithm::CRC32C:
+        crc = hasHardwareCrc32c() ? crc32cHardware(crc, p, size) : crc32cScalar(crc, p, size);
+        return;
+      case FingerprintAlgorithm::XXH64:
+      default:
+        updateXxh64(p, size);
+        return;
+    }
+  }
+
+  /** Adds a contiguous range of data. */
+  template <std::ranges::contiguous_range R>
+  void update(const R& range) {
+    update(std::ranges::data(range), std::ranges::size(range) * sizeof(std::ranges::range_value_t<R>));
+  }
+
+  /** @return the fingerprint of all data added so far - does not change the state */
+  [[nodiscard]] uint64_t digest() const {
+    using namespace fingerprint_detail;
+    switch (algo) {
+      case FingerprintAlgorithm::FNV1A:
+        return fnv;
+      case FingerprintAlgorithm::CRC32C:
+        return ~crc;
+      case FingerprintAlgorithm::XXH64:
+      default:
+        return digestXxh64();
+    }
+  }
+
+  [[nodiscard]] FingerprintAlgorithm algorithm() const { return algo; }
+  [[nodiscard]] uint64_t size() const { return totalSize; }
+
+ private:
+  FingerprintAlgorithm algo{};
+  uint64_t totalSize{};
+  uint64_t fnv{};
+  uint32_t crc{};
+  uint64_t v1{}, v2{}, v3{}, v4{};
+  std::array<unsigned char, 32> buffer{};
+  size_t bufferSize{};
+
+  void consumeStripe(const unsigned char* p) {
+    using namespace fingerprint_detail;
+    v1 = xxhRound(v1, read64(p));
+    v2 = xxhRound(v2, read64(p + 8));
+    v3 = xxhRound(v3, read64(p + 16));
+    v4 = xxhRound(v4, read64(p + 24));
+  }
+
+  void updateXxh64(const unsigned char* p, size_t size) {
+    // complete a partially filled stripe first
+    if (bufferSize > 0) {
+      const size_t fill = std::min(size, buffer.size() - bufferSize);
+      std::memcpy(buffer.data() + bufferSize, p, fill);
+      bufferSize += fill;
+      p += fill;
+      size -= fill;
+      if (bufferSize < buffer.size()) {
+        return;
+      }
+      consumeStripe(buffer.data());
+      bufferSize = 0;
+    }
+    while (size >= buffer.size()) {
+      consumeStripe(p);
+      p += buffer.size();
+      size -= buffer.size();
+    }
+    std::memcpy(buffer.data(), p, size);
+    bufferSize = size;
+  }
+
+  [[nodiscard]] uint64_t digestXxh64() const {
+    using namespace fingerprint_detail;
+    uint64_t h;
+    if (totalSize >= 32) {
+      h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+      h = xxhMergeRound(h, v1);
+      h = xxhMergeRound(h, v2);
+      h = xxhMergeRound(h, v3);
+      h = xxhMergeRound(h, v4);
+    } else {
+      h = XXH_PRIME64_5;
+    }
+    h += totalSize;
+
+    const unsigned char* p = buffer.data();
+    const unsigned char* const end = p + bufferSize;
+    while (p + 8 <= end) {
+      h ^= xxhRound(0, read64(p));
+      h = rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+      p += 8;
+    }
+    if (p + 4 <= end) {
+      h ^= static_cast<uint64_t>(read32(p)) * XXH_PRIME64_1;
+      h = rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+      p += 4;
+    }
+    while (p < end) {
+      h ^= static_cast<uint64_t>(*p) * XXH_PRIME64_5;
+      h = rotl64(h, 11) * XXH_PRIME64_1;
+      p++;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+  }
+};
+
 // Template function for fingerprinting vector data
+// Legacy element-wise FNV-1a - prefer fingerprint() which is several times faster on large data.
 template <typename T>
 uint64_t fingerPrintFVN(const std::vector<T>& vec) {
   // Define some constants for FNV-1a hash
@@ -4,7 +4,26 @@
 #ifndef FLYBYWIRE_LOGGING_H
 #define FLYBYWIRE_LOGGING_H
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <version>
+#ifdef __cpp_lib_format
+#include <format>
+#include <iterator>
+#endif
 
 /**
  * Simple logging facility for the FlyByWire Simulations C++ WASM framework.
@@ -15,6 +34,31 @@
  * LOG_INFO("PANEL_SERVICE_PRE_INSTALL");
  * LOG_INFO("PANEL_SERVICE_PRE_INSTALL: " + panelService->getPanelServiceName());
  *
+ * Levels can additionally be changed at runtime - globally and per module - down from the compile
+ * time LOG_LEVEL. The LOGF_* and LOGM_* macros take a std::format style format string - checked
+ * against the arguments at compile time where <format> is available - and format into a thread
+ * local buffer only if the level is enabled:
+ *
+ * LOGF_INFO("Received client data: {}", name);
+ * LOGM_DEBUG(streamLog, "chunk {} of {}", index, count);  // streamLog = logger->module("stream")
+ * logger->setLevels("info,stream=debug");
+ *
+ * A disabled statement costs one load and branch and does not evaluate its arguments.
+ *
+ * Messages which can come in storms - e.g. per received message - use the *_RATE variants. Each
+ * call site gets its own limit of messages per second. Suppressed messages only cost a clock read
+ * and a counter increment and are reported with the next message written from the same call site.
+ * Call logger->reportSuppressed() periodically and at shutdown so counts are also reported when
+ * no further message comes:
+ *
+ * LOGF_WARN_RATE(1, "Unhandled SimConnect message: {}", pRecv->dwID);
+ *
+ * Messages are written synchronously by default. After logger->startAsync() they are put into a
+ * preallocated lock-free ring and written in batches by a background thread so logging never waits
+ * for the console. The message text is still formatted on the calling thread - the arguments would
+ * otherwise have to be copied into the ring - the writer only adds the level prefix and module
+ * name. The LOG_* macros work the same in both modes.
+ *
  * This will be improved and extended in the future.
  * E.g. it could be extended to log to a file.
  */
@@ -29,69 +73,298 @@
 #define TRACE_LVL 7
 
 #if LOG_LEVEL > ZERO_LVL
-#define LOG_CRITICAL(msg) logger->critical(msg)
+#define LOG_CRITICAL(msg) (logger->enabled(CRITICAL_LVL) ? logger->critical(msg) : void(0))
+#define LOGF_CRITICAL(...) (logger->enabled(CRITICAL_LVL) ? logger->format(CRITICAL_LVL, logger->defaultModule(), __VA_ARGS__) : void(0))
+#define LOGM_CRITICAL(module, ...) ((module).enabled(CRITICAL_LVL) ? logger->format(CRITICAL_LVL, (module), __VA_ARGS__) : void(0))
+#define LOGF_CRITICAL_RATE(perSecond, ...) LOG_RATE_LIMITED(CRITICAL_LVL, logger->defaultModule(), perSecond, __VA_ARGS__)
+#define LOGM_CRITICAL_RATE(module, perSecond, ...) LOG_RATE_LIMITED(CRITICAL_LVL, (module), perSecond, __VA_ARGS__)
 #define LOG_CRITICAL_BLOCK(block) block
 #else
 #define LOG_CRITICAL(msg) void(0)
+#define LOGF_CRITICAL(...) void(0)
+#define LOGM_CRITICAL(module, ...) void(0)
+#define LOGF_CRITICAL_RATE(perSecond, ...) void(0)
+#define LOGM_CRITICAL_RATE(module, perSecond, ...) void(0)
 #define LOG_CRITICAL_BLOCK(block) void(0);
 #endif
 
-
 #if LOG_LEVEL > CRITICAL_LVL
-#define LOG_ERROR(msg) logger->error(msg)
+#define LOG_ERROR(msg) (logger->enabled(ERROR_LVL) ? logger->error(msg) : void(0))
+#define LOGF_ERROR(...) (logger->enabled(ERROR_LVL) ? logger->format(ERROR_LVL, logger->defaultModule(), __VA_ARGS__) : void(0))
+#define LOGM_ERROR(module, ...) ((module).enabled(ERROR_LVL) ? logger->format(ERROR_LVL, (module), __VA_ARGS__) : void(0))
+#define LOGF_ERROR_RATE(perSecond, ...) LOG_RATE_LIMITED(ERROR_LVL, logger->defaultModule(), perSecond, __VA_ARGS__)
+#define LOGM_ERROR_RATE(module, perSecond, ...) LOG_RATE_LIMITED(ERROR_LVL, (module), perSecond, __VA_ARGS__)
 #define LOG_ERROR_BLOCK(block) block
 #else
 #define LOG_ERROR(msg) void(0)
+#define LOGF_ERROR(...) void(0)
+#define LOGM_ERROR(module, ...) void(0)
+#define LOGF_ERROR_RATE(perSecond, ...) void(0)
+#define LOGM_ERROR_RATE(module, perSecond, ...) void(0)
 #define LOG_ERROR_BLOCK(block) void(0);
 #endif
 
 #if LOG_LEVEL > ERROR_LVL
-#define LOG_WARN(msg) logger->warn(msg)
+#define LOG_WARN(msg) (logger->enabled(WARN_LVL) ? logger->warn(msg) : void(0))
+#define LOGF_WARN(...) (logger->enabled(WARN_LVL) ? logger->format(WARN_LVL, logger->defaultModule(), __VA_ARGS__) : void(0))
+#define LOGM_WARN(module, ...) ((module).enabled(WARN_LVL) ? logger->format(WARN_LVL, (module), __VA_ARGS__) : void(0))
+#define LOGF_WARN_RATE(perSecond, ...) LOG_RATE_LIMITED(WARN_LVL, logger->defaultModule(), perSecond, __VA_ARGS__)
+#define LOGM_WARN_RATE(module, perSecond, ...) LOG_RATE_LIMITED(WARN_LVL, (module), perSecond, __VA_ARGS__)
 #define LOG_WARN_BLOCK(block) block
 #else
 #define LOG_WARN(msg) void(0)
+#define LOGF_WARN(...) void(0)
+#define LOGM_WARN(module, ...) void(0)
+#define LOGF_WARN_RATE(perSecond, ...) void(0)
+#define LOGM_WARN_RATE(module, perSecond, ...) void(0)
 #define LOG_WARN_BLOCK(block) void(0);
 #endif
 
 #if LOG_LEVEL > WARN_LVL
-#define LOG_INFO(msg) logger->info(msg)
+#define LOG_INFO(msg) (logger->enabled(INFO_LVL) ? logger->info(msg) : void(0))
+#define LOGF_INFO(...) (logger->enabled(INFO_LVL) ? logger->format(INFO_LVL, logger->defaultModule(), __VA_ARGS__) : void(0))
+#define LOGM_INFO(module, ...) ((module).enabled(INFO_LVL) ? logger->format(INFO_LVL, (module), __VA_ARGS__) : void(0))
+#define LOGF_INFO_RATE(perSecond, ...) LOG_RATE_LIMITED(INFO_LVL, logger->defaultModule(), perSecond, __VA_ARGS__)
+#define LOGM_INFO_RATE(module, perSecond, ...) LOG_RATE_LIMITED(INFO_LVL, (module), perSecond, __VA_ARGS__)
 #define LOG_INFO_BLOCK(block) block
 #else
 #define LOG_INFO(msg) void(0)
+#define LOGF_INFO(...) void(0)
+#define LOGM_INFO(module, ...) void(0)
+#define LOGF_INFO_RATE(perSecond, ...) void(0)
+#define LOGM_INFO_RATE(module, perSecond, ...) void(0)
 #define LOG_INFO_BLOCK(block) void(0);
 #endif
 
 #if LOG_LEVEL > INFO_LVL
-#define LOG_DEBUG(msg) logger->debug(msg)
+#define LOG_DEBUG(msg) (logger->enabled(DEBUG_LVL) ? logger->debug(msg) : void(0))
+#define LOGF_DEBUG(...) (logger->enabled(DEBUG_LVL) ? logger->format(DEBUG_LVL, logger->defaultModule(), __VA_ARGS__) : void(0))
+#define LOGM_DEBUG(module, ...) ((module).enabled(DEBUG_LVL) ? logger->format(DEBUG_LVL, (module), __VA_ARGS__) : void(0))
+#define LOGF_DEBUG_RATE(perSecond, ...) LOG_RATE_LIMITED(DEBUG_LVL, logger->defaultModule(), perSecond, __VA_ARGS__)
+#define LOGM_DEBUG_RATE(module, perSecond, ...) LOG_RATE_LIMITED(DEBUG_LVL, (module), perSecond, __VA_ARGS__)
 #define LOG_DEBUG_BLOCK(block) block
 #else
 #define LOG_DEBUG(msg) void(0)
+#define LOGF_DEBUG(...) void(0)
+#define LOGM_DEBUG(module, ...) void(0)
+#define LOGF_DEBUG_RATE(perSecond, ...) void(0)
+#define LOGM_DEBUG_RATE(module, perSecond, ...) void(0)
 #define LOG_DEBUG_BLOCK(block) void(0);
 #endif
 
 #if LOG_LEVEL > DEBUG_LVL
-#define LOG_VERBOSE(msg) logger->verbose(msg)
+#define LOG_VERBOSE(msg) (logger->enabled(VERBOSE_LVL) ? logger->verbose(msg) : void(0))
+#define LOGF_VERBOSE(...) (logger->enabled(VERBOSE_LVL) ? logger->format(VERBOSE_LVL, logger->defaultModule(), __VA_ARGS__) : void(0))
+#define LOGM_VERBOSE(module, ...) ((module).enabled(VERBOSE_LVL) ? logger->format(VERBOSE_LVL, (module), __VA_ARGS__) : void(0))
+#define LOGF_VERBOSE_RATE(perSecond, ...) LOG_RATE_LIMITED(VERBOSE_LVL, logger->defaultModule(), perSecond, __VA_ARGS__)
+#define LOGM_VERBOSE_RATE(module, perSecond, ...) LOG_RATE_LIMITED(VERBOSE_LVL, (module), perSecond, __VA_ARGS__)
 #define LOG_VERBOSE_BLOCK(block) block
 #else
 #define LOG_VERBOSE(msg) void(0)
+#define LOGF_VERBOSE(...) void(0)
+#define LOGM_VERBOSE(module, ...) void(0)
+#define LOGF_VERBOSE_RATE(perSecond, ...) void(0)
+#define LOGM_VERBOSE_RATE(module, perSecond, ...) void(0)
 #define LOG_VERBOSE_BLOCK(block) void(0);
 #endif
 
 #if LOG_LEVEL > VERBOSE_LVL
-#define LOG_TRACE(msg) logger->trace(msg)
+#define LOG_TRACE(msg) (logger->enabled(TRACE_LVL) ? logger->trace(msg) : void(0))
+#define LOGF_TRACE(...) (logger->enabled(TRACE_LVL) ? logger->format(TRACE_LVL, logger->defaultModule(), __VA_ARGS__) : void(0))
+#define LOGM_TRACE(module, ...) ((module).enabled(TRACE_LVL) ? logger->format(TRACE_LVL, (module), __VA_ARGS__) : void(0))
+#define LOGF_TRACE_RATE(perSecond, ...) LOG_RATE_LIMITED(TRACE_LVL, logger->defaultModule(), perSecond, __VA_ARGS__)
+#define LOGM_TRACE_RATE(module, perSecond, ...) LOG_RATE_LIMITED(TRACE_LVL, (module), perSecond, __VA_ARGS__)
 #define LOG_TRACE_BLOCK(block) block
 #else
 #define LOG_TRACE(msg) void(0)
+#define LOGF_TRACE(...) void(0)
+#define LOGM_TRACE(module, ...) void(0)
+#define LOGF_TRACE_RATE(perSecond, ...) void(0)
+#define LOGM_TRACE_RATE(module, perSecond, ...) void(0)
 #define LOG_TRACE_BLOCK(block) void(0);
 #endif
 
+// the limiter is a function local static per call site - constant initialized, so no guard check
+#define LOG_RATE_LIMITED(level, module, perSecond, ...)                                     \
+  do {                                                                                      \
+    static LogRateLimiter logRateLimiter{perSecond, __FILE__ ":" LOG_STRINGIFY(__LINE__)};  \
+    uint64_t logSuppressed = 0;                                                             \
+    if ((module).enabled(level)) {                                                          \
+      if (logRateLimiter.allow(logSuppressed)) {                                            \
+        logger->formatSuppressed(level, (module), logSuppressed, __VA_ARGS__);              \
+      } else {                                                                              \
+        logger->trackSuppressed(logRateLimiter, level, (module));                           \
+      }                                                                                     \
+    }                                                                                       \
+  } while (false)
+#define LOG_STRINGIFY(x) LOG_STRINGIFY_IMPL(x)
+#define LOG_STRINGIFY_IMPL(x) #x
+
+#ifdef LOG_LEVEL
+constexpr int LOG_LEVEL_COMPILED = LOG_LEVEL;
+#else
+constexpr int LOG_LEVEL_COMPILED = INFO_LVL;
+#endif
+
+namespace logging_detail {
+
+template <typename T>
+void appendNumber(std::string& out, T value) {
+  char buffer[64];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, result.ptr);
+}
+
+template <typename T>
+void appendArg(std::string& out, const T& value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    out.append(value ? "true" : "false");
+  } else if constexpr (std::is_same_v<T, char>) {
+    out.push_back(value);
+  } else if constexpr (std::is_enum_v<T>) {
+    appendNumber(out, static_cast<std::underlying_type_t<T>>(value));
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    appendNumber(out, value);
+  } else {
+    static_assert(std::is_convertible_v<const T&, std::string_view>, "unsupported log argument type");
+    out.append(std::string_view(value));
+  }
+}
+
+#ifdef __cpp_lib_format
+/** Format string of the LOGF_* and LOGM_* macros - checked against the arguments at compile time. */
+template <typename... Args>
+using FormatString = std::format_string<const Args&...>;
+#else
+/** Format string of the LOGF_* and LOGM_* macros - placeholders without an argument are dropped. */
+template <typename...>
+using FormatString = std::string_view;
+#endif
+
+/**
+ * Minimal std::format replacement for standard libraries without <format>.
+ * Supports {} placeholders (format specs are ignored) and {{ }} escapes.
+ */
+inline void formatTo(std::string& out, std::string_view format) {
+  for (size_t i = 0; i < format.size(); i++) {
+    out.push_back(format[i]);
+    if ((format[i] == '{' || format[i] == '}') && i + 1 < format.size() && format[i + 1] == format[i]) {
+      i++;
+    }
+  }
+}
+
+template <typename Arg, typename... Args>
+void formatTo(std::string& out, std::string_view format, const Arg& arg, const Args&... args) {
+  for (size_t i = 0; i < format.size(); i++) {
+    const char c = format[i];
+    if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c) {
+      out.push_back(c);
+      i++;
+    } else if (c == '{') {
+      const size_t close = format.find('}', i);
+      if (close == std::string_view::npos) {
+        break;
+      }
+      appendArg(out, arg);
+      formatTo(out, format.substr(close + 1), args...);
+      return;
+    } else {
+      out.push_back(c);
+    }
+  }
+}
+
+}  // namespace logging_detail
+
+/**
+ * Token bucket of one rate limited log call site, kept as the theoretical arrival time of the next
+ * message (GCRA) in a single atomic. Up to perSecond messages can be written in a burst, after
+ * that one message every 1 / perSecond seconds.
+ */
+class LogRateLimiter {
+public:
+  /** @param site file:line of the call site - used when the suppressed messages are reported on their own */
+  constexpr explicit LogRateLimiter(double perSecond, const char* site = "")
+      : interval(static_cast<int64_t>(1e9 / perSecond)), burst(interval * static_cast<int64_t>(perSecond < 1 ? 1 : perSecond)), callSite(site) {}
+
+  /**
+   * @param suppressed set to the number of messages suppressed since the last allowed one
+   * @return true if the message may be written
+   */
+  bool allow(uint64_t& suppressed) {
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t arrival = theoreticalArrival.load(std::memory_order_relaxed);
+    while (true) {
+      const int64_t earliest = std::max(arrival, now);
+      if (earliest - now > burst - interval) {
+        suppressedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      if (theoreticalArrival.compare_exchange_weak(arrival, earliest + interval, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    suppressed = suppressedCount.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+
+  /** @return the number of messages suppressed since the last allowed one - the count is reset */
+  uint64_t takeSuppressed() { return suppressedCount.exchange(0, std::memory_order_relaxed); }
+
+  /** @return true only for the first call - the call site is then known to the logger */
+  bool markTracked() { return !tracked.load(std::memory_order_relaxed) && !tracked.exchange(true, std::memory_order_relaxed); }
+
+  [[nodiscard]] const char* site() const { return callSite; }
+
+private:
+  const int64_t interval;  // ns between messages
+  const int64_t burst;     // ns of messages which may be written at once
+  const char* callSite;
+  std::atomic<int64_t> theoreticalArrival{0};
+  std::atomic<uint64_t> suppressedCount{0};
+  std::atomic<bool> tracked{false};
+};
+
+/**
+ * A part of the program with its own runtime log level - e.g. the stream protocol.
+ * Get one with logger->module(name) and keep the reference.
+ */
+class LogModule {
+public:
+  explicit LogModule(std::string moduleName) : moduleName(std::move(moduleName)) {}
+
+  /** @return true if messages of the level are written */
+  [[nodiscard]] bool enabled(int level) const { return level <= effectiveLevel.load(std::memory_order_relaxed); }
+  [[nodiscard]] const std::string& name() const { return moduleName; }
+  [[nodiscard]] int level() const { return effectiveLevel.load(std::memory_order_relaxed); }
+
+private:
+  friend class Logger;
+  std::string moduleName;
+  std::atomic<int> effectiveLevel{LOG_LEVEL_COMPILED};
+  int ownLevel = -1;  // -1 = follows the global level
+};
+
+/**
+ * What an async Logger does when its ring is full.
+ */
+enum class LogOverflowPolicy {
+  DROP,  // the message is dropped and counted - the caller never waits
+  BLOCK  // the caller waits until the writer thread made room
+};
+
 /**
  * Singleton class for Logger
  * Very simple implementation for now.
  */
 class Logger {
 public:
+  /** messages longer than this are truncated in async mode */
+  static constexpr size_t ASYNC_MESSAGE_SIZE = 240;
+
   Logger() = default;
+  ~Logger() { stopAsync(); }
   /** get the singleton instance of Logger */
   static Logger* instance() {
     static Logger instance;
@@ -104,13 +377,341 @@ public:
   Logger(Logger const &&) = delete;            // move
   Logger &operator=(const Logger &&) = delete; // move assignment
 
-  void critical(const std::string& msg) { std::cerr << "critical: " + msg << std::endl; }
-  void error(const std::string& msg) { std::cerr << "error: "       + msg << std::endl; }
-  void warn(const std::string& msg) { std::cerr << "warn: "         + msg << std::endl; }
-  void info(const std::string& msg) { std::cout << "info: "        << msg << std::endl; }
-  void debug(const std::string& msg) { std::cout << "debug: "      << msg << std::endl; }
-  void verbose(const std::string& msg) { std::cout << "verbose: "  << msg << std::endl; }
-  void trace(const std::string& msg) { std::cout << "trace: "      << msg << std::endl; }
+  void critical(std::string_view msg) { log(CRITICAL_LVL, mainModule, msg); }
+  void error(std::string_view msg) { log(ERROR_LVL, mainModule, msg); }
+  void warn(std::string_view msg) { log(WARN_LVL, mainModule, msg); }
+  void info(std::string_view msg) { log(INFO_LVL, mainModule, msg); }
+  void debug(std::string_view msg) { log(DEBUG_LVL, mainModule, msg); }
+  void verbose(std::string_view msg) { log(VERBOSE_LVL, mainModule, msg); }
+  void trace(std::string_view msg) { log(TRACE_LVL, mainModule, msg); }
+
+  /** @return true if messages of the level are written for the default module */
+  [[nodiscard]] bool enabled(int level) const { return mainModule.enabled(level); }
+
+  /** @return the module used by the LOG_* and LOGF_* macros */
+  LogModule& defaultModule() { return mainModule; }
+
+  /** Formats the arguments into a thread local buffer and writes the message - use the LOGF_* and LOGM_* macros. */
+  template <typename... Args>
+  void format(int level, const LogModule& module, logging_detail::FormatString<Args...> format, const Args&... args) {
+    formatSuppressed(level, module, 0, format, args...);
+  }
+
+  /** Like format() and appends the number of suppressed messages if any - use the *_RATE macros. */
+  template <typename... Args>
+  void formatSuppressed(int level,
+                        const LogModule& module,
+                        uint64_t suppressed,
+                        logging_detail::FormatString<Args...> format,
+                        const Args&... args) {
+    std::string& buffer = formatBuffer();
+    buffer.clear();
+#ifdef __cpp_lib_format
+    std::format_to(std::back_inserter(buffer), format, args...);
+#else
+    logging_detail::formatTo(buffer, format, args...);
+#endif
+    if (suppressed > 0) {
+      buffer.append(" (");
+      logging_detail::appendNumber(buffer, suppressed);
+      buffer.append(" similar messages suppressed)");
+    }
+    log(level, module, buffer);
+  }
+
+  /** Remembers a call site which suppressed a message so reportSuppressed() finds it - use the *_RATE macros. */
+  void trackSuppressed(LogRateLimiter& limiter, int level, const LogModule& module) {
+    if (limiter.markTracked()) {
+      std::lock_guard lock(suppressedMutex);
+      suppressedSites.push_back({&limiter, level, &module});
+    }
+  }
+
+  /**
+   * Writes the number of messages suppressed at each rate limited call site since its last message.
+   * Counts are otherwise only reported with the next message of the call site - call this periodically
+   * and at shutdown.
+   */
+  void reportSuppressed() {
+    std::lock_guard lock(suppressedMutex);
+    for (const auto& site : suppressedSites) {
+      const uint64_t suppressed = site.limiter->takeSuppressed();
+      if (suppressed == 0) {
+        continue;
+      }
+      const std::string_view path = site.limiter->site();
+      const size_t slash = path.find_last_of("/\\");
+      std::string message;
+      logging_detail::appendNumber(message, suppressed);
+      message.append(" similar messages suppressed at ");
+      message.append(slash == std::string_view::npos ? path : path.substr(slash + 1));
+      log(site.level, *site.module, message);
+    }
+  }
+
+  /** @return the module with the given name - created on first use, the reference stays valid */
+  LogModule& module(const std::string& name) {
+    std::lock_guard lock(levelMutex);
+    for (auto& m : modules) {
+      if (m.name() == name) {
+        return m;
+      }
+    }
+    auto& m = modules.emplace_back(name);
+    m.effectiveLevel.store(globalLevel, std::memory_order_relaxed);
+    return m;
+  }
+
+  /** Sets the level of the default module and of all modules without their own level. Capped at the compile time LOG_LEVEL. */
+  void setLevel(int level) {
+    std::lock_guard lock(levelMutex);
+    globalLevel = std::min(level, LOG_LEVEL_COMPILED);
+    mainModule.effectiveLevel.store(globalLevel, std::memory_order_relaxed);
+    for (auto& m : modules) {
+      if (m.ownLevel < 0) {
+        m.effectiveLevel.store(globalLevel, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /** Sets the level of a module - a negative level makes it follow the global level again. */
+  void setLevel(const std::string& moduleName, int level) {
+    LogModule& m = module(moduleName);
+    std::lock_guard lock(levelMutex);
+    m.ownLevel = level < 0 ? -1 : std::min(level, LOG_LEVEL_COMPILED);
+    m.effectiveLevel.store(m.ownLevel < 0 ? globalLevel : m.ownLevel, std::memory_order_relaxed);
+  }
+
+  /**
+   * Sets levels from a comma separated list of levels (global) and module=level entries.
+   * Levels are numbers (0-7) or names (off, critical, error, warn, info, debug, verbose, trace).
+   * E.g. "warn,stream=debug". Invalid entries are ignored.
+   * @return false if an entry was invalid
+   */
+  bool setLevels(std::string_view spec) {
+    bool valid = true;
+    while (!spec.empty()) {
+      const size_t comma = spec.find(',');
+      const std::string_view entry = spec.substr(0, comma);
+      spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+      const size_t equals = entry.find('=');
+      const int level = parseLevel(equals == std::string_view::npos ? entry : entry.substr(equals + 1));
+      if (level < 0) {
+        valid = false;
+      } else if (equals == std::string_view::npos) {
+        setLevel(level);
+      } else {
+        setLevel(std::string(entry.substr(0, equals)), level);
+      }
+    }
+    return valid;
+  }
+
+  /**
+   * Switches to async mode. Not thread safe - call before other threads log.
+   * @param capacity number of messages the ring holds - rounded up to a power of two
+   */
+  void startAsync(size_t capacity = 4096, LogOverflowPolicy policy = LogOverflowPolicy::DROP) {
+    if (writer.joinable()) {
+      return;
+    }
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    slots = std::make_unique<Slot[]>(size);
+    for (size_t i = 0; i < size; i++) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask = size - 1;
+    enqueuePosition.store(0, std::memory_order_relaxed);
+    dequeuePosition = 0;
+    overflowPolicy = policy;
+    stopping.store(false, std::memory_order_relaxed);
+    writer = std::thread([this] { writeLoop(); });
+    async.store(true, std::memory_order_release);
+  }
+
+  /** Writes all queued messages and returns to synchronous mode. Not thread safe - call after other threads stopped logging. */
+  void stopAsync() {
+    if (!writer.joinable()) {
+      return;
+    }
+    async.store(false, std::memory_order_release);
+    stopping.store(true, std::memory_order_release);
+    wakeWriter();
+    writer.join();
+  }
+
+  /** @return number of messages dropped because the async ring was full */
+  [[nodiscard]] uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence{0};
+    const LogModule* module = nullptr;
+    uint8_t level = INFO_LVL;
+    uint8_t truncated = 0;
+    uint16_t length = 0;
+    char text[ASYNC_MESSAGE_SIZE];
+  };
+
+  static constexpr const char* LEVEL_NAMES[] = {"off", "critical", "error", "warn", "info", "debug", "verbose", "trace"};
+
+  static const char* prefix(int level) {
+    switch (level) {
+      case CRITICAL_LVL: return "critical: ";
+      case ERROR_LVL: return "error: ";
+      case WARN_LVL: return "warn: ";
+      case INFO_LVL: return "info: ";
+      case DEBUG_LVL: return "debug: ";
+      case VERBOSE_LVL: return "verbose: ";
+      default: return "trace: ";
+    }
+  }
+
+  /** one buffer per thread shared by all format() instantiations - keeps its capacity so formatting does not allocate */
+  static std::string& formatBuffer() {
+    thread_local std::string buffer;
+    return buffer;
+  }
+
+  static bool isError(int level) { return level <= WARN_LVL; }
+
+  static int parseLevel(std::string_view name) {
+    for (int level = ZERO_LVL; level <= TRACE_LVL; level++) {
+      if (name == LEVEL_NAMES[level] || (name.size() == 1 && name[0] == '0' + level)) {
+        return level;
+      }
+    }
+    return -1;
+  }
+
+  void log(int level, const LogModule& module, std::string_view msg) {
+    if (!async.load(std::memory_order_acquire)) {
+      auto& stream = isError(level) ? std::cerr : std::cout;
+      stream << prefix(level);
+      if (!module.name().empty()) {
+        stream << '[' << module.name() << "] ";
+      }
+      stream << msg << std::endl;
+      return;
+    }
+    while (!tryEnqueue(level, module, msg)) {
+      if (overflowPolicy == LogOverflowPolicy::DROP) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      wakeWriter();
+      std::this_thread::yield();
+    }
+    // pairs with the writer announcing its sleep before checking the ring a last time
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writerSleeping.load(std::memory_order_relaxed)) {
+      wakeWriter();
+    }
+  }
+
+  /** bounded multi producer queue - each slot's sequence tells whether it is free for the position or holds its message */
+  bool tryEnqueue(int level, const LogModule& module, std::string_view msg) {
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots[position & mask];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (diff == 0) {
+        if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        position = enqueuePosition.load(std::memory_order_relaxed);
+      }
+    }
+    slot->level = static_cast<uint8_t>(level);
+    slot->module = &module;
+    slot->length = static_cast<uint16_t>(std::min(msg.size(), ASYNC_MESSAGE_SIZE));
+    slot->truncated = msg.size() > ASYNC_MESSAGE_SIZE;
+    std::memcpy(slot->text, msg.data(), slot->length);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  void wakeWriter() {
+    writerSleeping.store(false, std::memory_order_release);
+    writerSleeping.notify_one();
+  }
+
+  /** writer thread - prefixes all available messages into one buffer per stream and writes them at once */
+  void writeLoop() {
+    std::string out;
+    std::string err;
+    while (true) {
+      while (true) {
+        Slot& slot = slots[dequeuePosition & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+          break;
+        }
+        std::string& buffer = isError(slot.level) ? err : out;
+        buffer.append(prefix(slot.level));
+        if (!slot.module->name().empty()) {
+          buffer.append("[").append(slot.module->name()).append("] ");
+        }
+        buffer.append(slot.text, slot.length).append(slot.truncated ? "...\n" : "\n");
+        slot.sequence.store(dequeuePosition + mask + 1, std::memory_order_release);
+        dequeuePosition++;
+      }
+      if (!err.empty()) {
+        std::cerr.write(err.data(), static_cast<std::streamsize>(err.size())).flush();
+        err.clear();
+      }
+      if (!out.empty()) {
+        std::cout.write(out.data(), static_cast<std::streamsize>(out.size())).flush();
+        out.clear();
+      }
+      if (stopping.load(std::memory_order_acquire)) {
+        // producers are gone - write what is left before ending
+        if (slots[dequeuePosition & mask].sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+          return;
+        }
+        continue;
+      }
+      // announce the sleep, then check once more so a message queued in between is not missed
+      writerSleeping.store(true, std::memory_order_seq_cst);
+      if (slots[dequeuePosition & mask].sequence.load(std::memory_order_seq_cst) == dequeuePosition + 1 ||
+          stopping.load(std::memory_order_acquire)) {
+        writerSleeping.store(false, std::memory_order_relaxed);
+        continue;
+      }
+      writerSleeping.wait(true, std::memory_order_acquire);
+    }
+  }
+
+  LogModule mainModule{""};
+  std::deque<LogModule> modules;  // deque - references handed out by module() stay valid
+  std::mutex levelMutex;
+  int globalLevel = LOG_LEVEL_COMPILED;
+
+  struct SuppressedSite {
+    LogRateLimiter* limiter;
+    int level;
+    const LogModule* module;
+  };
+  std::vector<SuppressedSite> suppressedSites;  // rate limited call sites which suppressed messages
+  std::mutex suppressedMutex;
+
+  std::atomic<bool> async{false};
+  LogOverflowPolicy overflowPolicy = LogOverflowPolicy::DROP;
+  std::unique_ptr<Slot[]> slots;
+  size_t mask = 0;
+  alignas(64) std::atomic<size_t> enqueuePosition{0};
+  alignas(64) size_t dequeuePosition = 0;  // writer thread only
+  std::atomic<bool> writerSleeping{false};
+  std::atomic<bool> stopping{false};
+  std::atomic<uint64_t> dropped{0};
+  std::thread writer;
 };
 
 inline Logger* logger = Logger::instance();
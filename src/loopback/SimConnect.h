@@ -0,0 +1,358 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_LOOPBACK_SIMCONNECT_H
+#define FBW_CPP_FRAMEWORK_TEST_LOOPBACK_SIMCONNECT_H
+
+/**
+ * Stand-in for the MSFS SDK SimConnect.h used on non-Windows hosts.
+ *
+ * Declares only the subset of the SimConnect API this client uses and implements it with an
+ * in-process loopback (see SimConnectLoopback.h) so the client can be built, run and profiled
+ * without a simulator. Types, constants and struct layouts mirror the SDK header.
+ */
+
+#include <cstdint>
+
+// =========================
+// Windows types and helpers
+
+typedef uint32_t DWORD;
+typedef int32_t HRESULT;
+typedef int32_t BOOL;
+typedef void* HANDLE;
+typedef void* HWND;
+typedef const char* LPCSTR;
+typedef int8_t INT8;
+typedef int16_t INT16;
+typedef int32_t INT32;
+typedef int64_t INT64;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+
+#ifndef S_OK
+#define S_OK ((HRESULT)0L)
+#endif
+#ifndef E_FAIL
+#define E_FAIL ((HRESULT)0x80004005L)
+#endif
+#ifndef SUCCEEDED
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#endif
+#ifndef CALLBACK
+#define CALLBACK
+#endif
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+
+/** Blocks the calling thread for the given number of milliseconds (Win32 Sleep). */
+void Sleep(DWORD dwMilliseconds);
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef INFINITE
+#define INFINITE 0xFFFFFFFF
+#endif
+#define WAIT_OBJECT_0 0x00000000L
+#define WAIT_TIMEOUT 0x00000102L
+#define WAIT_FAILED 0xFFFFFFFF
+
+/**
+ * Creates an event object (Win32 CreateEvent). An event given to SimConnect_Open is signaled by the
+ * loopback whenever a message becomes available for SimConnect_GetNextDispatch.
+ */
+HANDLE CreateEvent(void* lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCSTR lpName);
+/** Signals an event object (Win32 SetEvent). */
+BOOL SetEvent(HANDLE hEvent);
+/** Destroys an event object created with CreateEvent (Win32 CloseHandle). */
+BOOL CloseHandle(HANDLE hObject);
+/**
+ * Waits until the event is signaled or the timeout expires (Win32 WaitForSingleObject).
+ * @return WAIT_OBJECT_0, WAIT_TIMEOUT or WAIT_FAILED
+ */
+DWORD WaitForSingleObject(HANDLE hHandle, DWORD dwMilliseconds);
+
+// =========================
+// SimConnect constants
+
+#ifndef DWORD_MAX
+#define DWORD_MAX 0xFFFFFFFF
+#endif
+#define SIMCONNECT_UNUSED DWORD_MAX
+
+#define SIMCONNECT_OBJECT_ID_USER 0
+#define SIMCONNECT_CLIENTDATA_MAX_SIZE 8192
+#define SIMCONNECT_CLIENTDATAOFFSET_AUTO (-1)
+
+typedef DWORD SIMCONNECT_OBJECT_ID;
+typedef DWORD SIMCONNECT_CLIENT_EVENT_ID;
+typedef DWORD SIMCONNECT_DATA_DEFINITION_ID;
+typedef DWORD SIMCONNECT_DATA_REQUEST_ID;
+typedef DWORD SIMCONNECT_CLIENT_DATA_ID;
+typedef DWORD SIMCONNECT_CLIENT_DATA_DEFINITION_ID;
+
+typedef DWORD SIMCONNECT_DATA_REQUEST_FLAG;
+static const DWORD SIMCONNECT_DATA_REQUEST_FLAG_DEFAULT = 0x00000000;
+
+typedef DWORD SIMCONNECT_CREATE_CLIENT_DATA_FLAG;
+static const DWORD SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT = 0x00000000;
+static const DWORD SIMCONNECT_CREATE_CLIENT_DATA_FLAG_READ_ONLY = 0x00000001;
+
+typedef DWORD SIMCONNECT_CLIENT_DATA_REQUEST_FLAG;
+static const DWORD SIMCONNECT_CLIENT_DATA_REQUEST_FLAG_DEFAULT = 0x00000000;
+
+typedef DWORD SIMCONNECT_CLIENT_DATA_SET_FLAG;
+static const DWORD SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT = 0x00000000;
+
+enum SIMCONNECT_RECV_ID {
+  SIMCONNECT_RECV_ID_NULL,
+  SIMCONNECT_RECV_ID_EXCEPTION,
+  SIMCONNECT_RECV_ID_OPEN,
+  SIMCONNECT_RECV_ID_QUIT,
+  SIMCONNECT_RECV_ID_EVENT,
+  SIMCONNECT_RECV_ID_EVENT_OBJECT_ADDREMOVE,
+  SIMCONNECT_RECV_ID_EVENT_FILENAME,
+  SIMCONNECT_RECV_ID_EVENT_FRAME,
+  SIMCONNECT_RECV_ID_SIMOBJECT_DATA,
+  SIMCONNECT_RECV_ID_SIMOBJECT_DATA_BYTYPE,
+  SIMCONNECT_RECV_ID_WEATHER_OBSERVATION,
+  SIMCONNECT_RECV_ID_CLOUD_STATE,
+  SIMCONNECT_RECV_ID_ASSIGNED_OBJECT_ID,
+  SIMCONNECT_RECV_ID_RESERVED_KEY,
+  SIMCONNECT_RECV_ID_CUSTOM_ACTION,
+  SIMCONNECT_RECV_ID_SYSTEM_STATE,
+  SIMCONNECT_RECV_ID_CLIENT_DATA,
+  SIMCONNECT_RECV_ID_EVENT_WEATHER_MODE,
+  SIMCONNECT_RECV_ID_AIRPORT_LIST,
+  SIMCONNECT_RECV_ID_VOR_LIST,
+  SIMCONNECT_RECV_ID_NDB_LIST,
+  SIMCONNECT_RECV_ID_WAYPOINT_LIST,
+  SIMCONNECT_RECV_ID_EVENT_MULTIPLAYER_SERVER_STARTED,
+  SIMCONNECT_RECV_ID_EVENT_MULTIPLAYER_CLIENT_STARTED,
+  SIMCONNECT_RECV_ID_EVENT_MULTIPLAYER_SESSION_ENDED,
+  SIMCONNECT_RECV_ID_EVENT_RACE_END,
+  SIMCONNECT_RECV_ID_EVENT_RACE_LAP,
+  SIMCONNECT_RECV_ID_EVENT_EX1,
+  SIMCONNECT_RECV_ID_FACILITY_DATA,
+  SIMCONNECT_RECV_ID_FACILITY_DATA_END,
+  SIMCONNECT_RECV_ID_FACILITY_MINIMAL_LIST,
+  SIMCONNECT_RECV_ID_JETWAY_DATA,
+  SIMCONNECT_RECV_ID_CONTROLLERS_LIST,
+  SIMCONNECT_RECV_ID_ACTION_CALLBACK,
+  SIMCONNECT_RECV_ID_ENUMERATE_INPUT_EVENTS,
+  SIMCONNECT_RECV_ID_GET_INPUT_EVENT,
+  SIMCONNECT_RECV_ID_SUBSCRIBE_INPUT_EVENT,
+  SIMCONNECT_RECV_ID_ENUMERATE_INPUT_EVENT_PARAMS,
+};
+
+enum SIMCONNECT_DATATYPE {
+  SIMCONNECT_DATATYPE_INVALID,
+  SIMCONNECT_DATATYPE_INT32,
+  SIMCONNECT_DATATYPE_INT64,
+  SIMCONNECT_DATATYPE_FLOAT32,
+  SIMCONNECT_DATATYPE_FLOAT64,
+  SIMCONNECT_DATATYPE_STRING8,
+  SIMCONNECT_DATATYPE_STRING32,
+  SIMCONNECT_DATATYPE_STRING64,
+  SIMCONNECT_DATATYPE_STRING128,
+  SIMCONNECT_DATATYPE_STRING256,
+  SIMCONNECT_DATATYPE_STRING260,
+  SIMCONNECT_DATATYPE_STRINGV,
+  SIMCONNECT_DATATYPE_INITPOSITION,
+  SIMCONNECT_DATATYPE_MARKERSTATE,
+  SIMCONNECT_DATATYPE_WAYPOINT,
+  SIMCONNECT_DATATYPE_LATLONALT,
+  SIMCONNECT_DATATYPE_XYZ,
+  SIMCONNECT_DATATYPE_MAX
+};
+
+enum SIMCONNECT_EXCEPTION {
+  SIMCONNECT_EXCEPTION_NONE,
+  SIMCONNECT_EXCEPTION_ERROR,
+  SIMCONNECT_EXCEPTION_SIZE_MISMATCH,
+  SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID,
+  SIMCONNECT_EXCEPTION_UNOPENED,
+  SIMCONNECT_EXCEPTION_VERSION_MISMATCH,
+  SIMCONNECT_EXCEPTION_TOO_MANY_GROUPS,
+  SIMCONNECT_EXCEPTION_NAME_UNRECOGNIZED,
+  SIMCONNECT_EXCEPTION_TOO_MANY_EVENT_NAMES,
+  SIMCONNECT_EXCEPTION_EVENT_ID_DUPLICATE,
+  SIMCONNECT_EXCEPTION_TOO_MANY_MAPS,
+  SIMCONNECT_EXCEPTION_TOO_MANY_OBJECTS,
+  SIMCONNECT_EXCEPTION_TOO_MANY_REQUESTS,
+  SIMCONNECT_EXCEPTION_WEATHER_INVALID_PORT,
+  SIMCONNECT_EXCEPTION_WEATHER_INVALID_METAR,
+  SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_GET_OBSERVATION,
+  SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_CREATE_STATION,
+  SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_REMOVE_STATION,
+  SIMCONNECT_EXCEPTION_INVALID_DATA_TYPE,
+  SIMCONNECT_EXCEPTION_INVALID_DATA_SIZE,
+  SIMCONNECT_EXCEPTION_DATA_ERROR,
+  SIMCONNECT_EXCEPTION_INVALID_ARRAY,
+  SIMCONNECT_EXCEPTION_CREATE_OBJECT_FAILED,
+  SIMCONNECT_EXCEPTION_LOAD_FLIGHTPLAN_FAILED,
+  SIMCONNECT_EXCEPTION_OPERATION_INVALID_FOR_OBJECT_TYPE,
+  SIMCONNECT_EXCEPTION_ILLEGAL_OPERATION,
+  SIMCONNECT_EXCEPTION_ALREADY_SUBSCRIBED,
+  SIMCONNECT_EXCEPTION_INVALID_ENUM,
+  SIMCONNECT_EXCEPTION_DEFINITION_ERROR,
+  SIMCONNECT_EXCEPTION_DUPLICATE_ID,
+  SIMCONNECT_EXCEPTION_DATUM_ID,
+  SIMCONNECT_EXCEPTION_OUT_OF_BOUNDS,
+  SIMCONNECT_EXCEPTION_ALREADY_CREATED,
+  SIMCONNECT_EXCEPTION_OBJECT_OUTSIDE_REALITY_BUBBLE,
+  SIMCONNECT_EXCEPTION_OBJECT_CONTAINER,
+  SIMCONNECT_EXCEPTION_OBJECT_AI,
+  SIMCONNECT_EXCEPTION_OBJECT_ATC,
+  SIMCONNECT_EXCEPTION_OBJECT_SCHEDULE,
+};
+
+enum SIMCONNECT_PERIOD {
+  SIMCONNECT_PERIOD_NEVER,
+  SIMCONNECT_PERIOD_ONCE,
+  SIMCONNECT_PERIOD_VISUAL_FRAME,
+  SIMCONNECT_PERIOD_SIM_FRAME,
+  SIMCONNECT_PERIOD_SECOND,
+};
+
+enum SIMCONNECT_CLIENT_DATA_PERIOD {
+  SIMCONNECT_CLIENT_DATA_PERIOD_NEVER,
+  SIMCONNECT_CLIENT_DATA_PERIOD_ONCE,
+  SIMCONNECT_CLIENT_DATA_PERIOD_VISUAL_FRAME,
+  SIMCONNECT_CLIENT_DATA_PERIOD_ON_SET,
+  SIMCONNECT_CLIENT_DATA_PERIOD_SECOND,
+};
+
+// =========================
+// Received message structures
+
+#pragma pack(push, 1)
+
+struct SIMCONNECT_RECV {
+  DWORD dwSize;
+  DWORD dwVersion;
+  DWORD dwID;
+};
+
+struct SIMCONNECT_RECV_EXCEPTION : public SIMCONNECT_RECV {
+  DWORD dwException;
+  static const DWORD UNKNOWN_SENDID = 0;
+  DWORD dwSendID;
+  static const DWORD UNKNOWN_INDEX = DWORD_MAX;
+  DWORD dwIndex;
+};
+
+struct SIMCONNECT_RECV_OPEN : public SIMCONNECT_RECV {
+  char szApplicationName[256];
+  DWORD dwApplicationVersionMajor;
+  DWORD dwApplicationVersionMinor;
+  DWORD dwApplicationBuildMajor;
+  DWORD dwApplicationBuildMinor;
+  DWORD dwSimConnectVersionMajor;
+  DWORD dwSimConnectVersionMinor;
+  DWORD dwSimConnectBuildMajor;
+  DWORD dwSimConnectBuildMinor;
+  DWORD dwReserved1;
+  DWORD dwReserved2;
+};
+
+struct SIMCONNECT_RECV_QUIT : public SIMCONNECT_RECV {};
+
+struct SIMCONNECT_RECV_EVENT : public SIMCONNECT_RECV {
+  static const DWORD UNKNOWN_GROUP = DWORD_MAX;
+  DWORD uGroupID;
+  DWORD uEventID;
+  DWORD dwData;
+};
+
+struct SIMCONNECT_RECV_SIMOBJECT_DATA : public SIMCONNECT_RECV {
+  DWORD dwRequestID;
+  DWORD dwObjectID;
+  DWORD dwDefineID;
+  DWORD dwFlags;
+  DWORD dwentrynumber;
+  DWORD dwoutof;
+  DWORD dwDefineCount;
+  DWORD dwData;
+};
+
+struct SIMCONNECT_RECV_CLIENT_DATA : public SIMCONNECT_RECV_SIMOBJECT_DATA {};
+
+struct SIMCONNECT_RECV_SYSTEM_STATE : public SIMCONNECT_RECV {
+  DWORD dwRequestID;
+  DWORD dwInteger;
+  float fFloat;
+  char szString[MAX_PATH];
+};
+
+#pragma pack(pop)
+
+typedef void(CALLBACK* DispatchProc)(SIMCONNECT_RECV* pData, DWORD cbData, void* pContext);
+
+// =========================
+// SimConnect functions
+
+HRESULT SimConnect_Open(HANDLE* phSimConnect, LPCSTR szName, HWND hWnd, DWORD UserEventWin32, HANDLE hEventHandle, DWORD ConfigIndex);
+HRESULT SimConnect_Close(HANDLE hSimConnect);
+HRESULT SimConnect_GetNextDispatch(HANDLE hSimConnect, SIMCONNECT_RECV** ppData, DWORD* pcbData);
+
+HRESULT SimConnect_SubscribeToSystemEvent(HANDLE hSimConnect, SIMCONNECT_CLIENT_EVENT_ID EventID, const char* SystemEventName);
+
+HRESULT SimConnect_AddToDataDefinition(HANDLE hSimConnect,
+                                       SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                       const char* DatumName,
+                                       const char* UnitsName,
+                                       SIMCONNECT_DATATYPE DatumType = SIMCONNECT_DATATYPE_FLOAT64,
+                                       float fEpsilon = 0,
+                                       DWORD DatumID = SIMCONNECT_UNUSED);
+
+HRESULT SimConnect_RequestDataOnSimObject(HANDLE hSimConnect,
+                                          SIMCONNECT_DATA_REQUEST_ID RequestID,
+                                          SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                          SIMCONNECT_OBJECT_ID ObjectID,
+                                          SIMCONNECT_PERIOD Period,
+                                          SIMCONNECT_DATA_REQUEST_FLAG Flags = 0,
+                                          DWORD origin = 0,
+                                          DWORD interval = 0,
+                                          DWORD limit = 0);
+
+HRESULT SimConnect_MapClientDataNameToID(HANDLE hSimConnect, const char* szClientDataName, SIMCONNECT_CLIENT_DATA_ID ClientDataID);
+
+HRESULT SimConnect_CreateClientData(HANDLE hSimConnect,
+                                    SIMCONNECT_CLIENT_DATA_ID ClientDataID,
+                                    DWORD dwSize,
+                                    SIMCONNECT_CREATE_CLIENT_DATA_FLAG Flags);
+
+HRESULT SimConnect_AddToClientDataDefinition(HANDLE hSimConnect,
+                                             SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID,
+                                             DWORD dwOffset,
+                                             DWORD dwSizeOrType,
+                                             float fEpsilon = 0,
+                                             DWORD DatumID = SIMCONNECT_UNUSED);
+
+HRESULT SimConnect_RequestClientData(HANDLE hSimConnect,
+                                     SIMCONNECT_CLIENT_DATA_ID ClientDataID,
+                                     SIMCONNECT_DATA_REQUEST_ID RequestID,
+                                     SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID,
+                                     SIMCONNECT_CLIENT_DATA_PERIOD Period = SIMCONNECT_CLIENT_DATA_PERIOD_ONCE,
+                                     SIMCONNECT_CLIENT_DATA_REQUEST_FLAG Flags = 0,
+                                     DWORD origin = 0,
+                                     DWORD interval = 0,
+                                     DWORD limit = 0);
+
+HRESULT SimConnect_SetClientData(HANDLE hSimConnect,
+                                 SIMCONNECT_CLIENT_DATA_ID ClientDataID,
+                                 SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID,
+                                 SIMCONNECT_CLIENT_DATA_SET_FLAG Flags,
+                                 DWORD dwReserved,
+                                 DWORD cbUnitSize,
+                                 void* pDataSet);
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_LOOPBACK_SIMCONNECT_H
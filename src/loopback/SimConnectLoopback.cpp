@@ -0,0 +1,716 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "SimConnect.h"
+#include "SimConnectLoopback.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr DWORD TITLE_SIZE = 256;
+
+// data messages carry their payload starting at the trailing dwData member
+constexpr size_t DATA_HEADER_SIZE = sizeof(SIMCONNECT_RECV_SIMOBJECT_DATA) - sizeof(DWORD);
+
+struct Datum {
+  DWORD offset;
+  DWORD size;
+};
+
+struct Area {
+  std::string name;
+  std::vector<char> data;
+};
+
+struct ClientDataRequest {
+  SIMCONNECT_DATA_REQUEST_ID requestId;
+  SIMCONNECT_CLIENT_DATA_ID areaId;
+  SIMCONNECT_CLIENT_DATA_DEFINITION_ID defineId;
+};
+
+struct Message {
+  Clock::time_point due;
+  bool droppable;
+  int64_t coalesceKey;  // ON_SET messages of the same request within one frame replace each other - -1 for none
+  std::vector<char> bytes;
+};
+
+/**
+ * Win32 style event object. Besides being set directly it can be armed to become signaled at a
+ * point in time - the loopback uses this to signal the client when a queued message becomes due
+ * without needing a thread of its own.
+ */
+struct Event {
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool manualReset;
+  bool signaled;
+  std::optional<Clock::time_point> signalAt;
+
+  Event(bool manual, bool initialState) : manualReset(manual), signaled(initialState) {}
+
+  void set() {
+    std::lock_guard lock(mutex);
+    signaled = true;
+    changed.notify_all();
+  }
+
+  /** Signals the event at the given time unless it is already armed for an earlier time. */
+  void arm(Clock::time_point due) {
+    std::lock_guard lock(mutex);
+    if (!signalAt || due < *signalAt) {
+      signalAt = due;
+      changed.notify_all();
+    }
+  }
+
+  /** @return true if the event was signaled before the deadline */
+  bool wait(std::optional<Clock::time_point> deadline) {
+    std::unique_lock lock(mutex);
+    while (true) {
+      const auto now = Clock::now();
+      if (signalAt && *signalAt <= now) {
+        signaled = true;
+        signalAt.reset();
+      }
+      if (signaled) {
+        signaled = manualReset;
+        return true;
+      }
+      if (deadline && *deadline <= now) {
+        return false;
+      }
+      auto until = deadline;
+      if (signalAt && (!until || *signalAt < *until)) {
+        until = signalAt;
+      }
+      if (until) {
+        changed.wait_until(lock, *until);
+      } else {
+        changed.wait(lock);
+      }
+    }
+  }
+};
+
+/**
+ * The simulator side of the loopback connection.
+ * All state is guarded by one recursive mutex so peer handlers may call back into the loopback.
+ */
+class Loopback {
+ public:
+  std::recursive_mutex mutex;
+
+  bool open = false;
+  SimConnectLoopback::Config config{};
+  SimConnectLoopback::Stats stats{};
+  std::mt19937 rng{0};
+
+  std::unordered_map<std::string, Area> areas;
+  std::unordered_map<SIMCONNECT_CLIENT_DATA_ID, std::string> areaIds;
+  std::unordered_map<SIMCONNECT_CLIENT_DATA_DEFINITION_ID, std::vector<Datum>> clientDefinitions;
+  std::unordered_map<SIMCONNECT_DATA_DEFINITION_ID, DWORD> simObjectDefinitionSizes;
+  std::vector<ClientDataRequest> onSetRequests;
+  std::unordered_map<std::string, std::string> mirrors;
+  std::unordered_multimap<std::string, SimConnectLoopback::PeerHandler> peerHandlers;
+
+  std::deque<Message> queue;
+  Event* event = nullptr;  // signaled when a message becomes due - given to SimConnect_Open
+  Clock::time_point lastDue{};
+  std::vector<char> current;
+  DWORD sendId = 0;
+
+  static Loopback& instance() {
+    static Loopback loopback;
+    return loopback;
+  }
+
+  [[nodiscard]] bool isValid(HANDLE hSimConnect) const { return open && hSimConnect == static_cast<const void*>(this); }
+
+  Area& area(const std::string& name) {
+    auto& area = areas[name];
+    area.name = name;
+    return area;
+  }
+
+  Area* areaById(SIMCONNECT_CLIENT_DATA_ID id) {
+    const auto it = areaIds.find(id);
+    return it == areaIds.end() ? nullptr : &area(it->second);
+  }
+
+  static void ensureSize(Area& area, size_t size) {
+    if (area.data.size() < size) {
+      area.data.resize(size, 0);
+    }
+  }
+
+  static DWORD definitionSize(const std::vector<Datum>& datums) {
+    DWORD size = 0;
+    for (const auto& datum : datums) {
+      size += datum.size;
+    }
+    return size;
+  }
+
+  static void writeArea(Area& area, const std::vector<Datum>& datums, const char* src) {
+    for (const auto& datum : datums) {
+      ensureSize(area, datum.offset + datum.size);
+      std::memcpy(area.data.data() + datum.offset, src, datum.size);
+      src += datum.size;
+    }
+  }
+
+  static void readArea(Area& area, const std::vector<Datum>& datums, char* dst) {
+    for (const auto& datum : datums) {
+      ensureSize(area, datum.offset + datum.size);
+      std::memcpy(dst, area.data.data() + datum.offset, datum.size);
+      dst += datum.size;
+    }
+  }
+
+  /**
+   * Puts a message on the simulated link. Messages keep their order, so the due time of a message is
+   * never earlier than the one of its predecessor. Bandwidth adds the serialization time of the message.
+   * With a frame period coalescable messages are delivered on the next frame and a newer message with the
+   * same key replaces an undelivered one of the same frame - like the sim only publishing the latest
+   * content of a client data area once per frame.
+   */
+  void enqueue(std::vector<char>&& bytes, bool droppable, int64_t coalesceKey = -1) {
+    stats.messagesQueued++;
+    if (droppable && config.dropRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng) < config.dropRate) {
+      stats.messagesDropped++;
+      return;
+    }
+    const auto now = Clock::now();
+    auto due = now + config.latency;
+    if (config.jitter.count() > 0) {
+      due += std::chrono::microseconds(std::uniform_int_distribution<int64_t>(0, config.jitter.count())(rng));
+    }
+    if (config.bandwidth > 0.0) {
+      const auto start = std::max(due, lastDue);
+      due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(bytes.size() / config.bandwidth));
+    }
+    due = std::max(due, lastDue);
+    if (config.framePeriod.count() > 0 && coalesceKey >= 0) {
+      const auto period = std::chrono::duration_cast<Clock::duration>(config.framePeriod);
+      const auto frames = (due.time_since_epoch() + period - Clock::duration(1)) / period;
+      due = Clock::time_point(frames * period);
+      for (auto it = queue.rbegin(); it != queue.rend() && it->due >= due; ++it) {
+        if (it->coalesceKey == coalesceKey && it->due == due) {
+          it->bytes = std::move(bytes);
+          stats.messagesCoalesced++;
+          return;
+        }
+      }
+    }
+    lastDue = due;
+    queue.push_back({due, droppable, coalesceKey, std::move(bytes)});
+    if (event != nullptr) {
+      event->arm(due);
+    }
+  }
+
+  template <typename T>
+  static std::vector<char> makeMessage(SIMCONNECT_RECV_ID id, size_t size = sizeof(T)) {
+    std::vector<char> bytes(std::max(size, sizeof(T)), 0);
+    auto* recv = reinterpret_cast<SIMCONNECT_RECV*>(bytes.data());
+    recv->dwSize = static_cast<DWORD>(bytes.size());
+    recv->dwVersion = 0;
+    recv->dwID = id;
+    return bytes;
+  }
+
+  void queueException(SIMCONNECT_EXCEPTION exception, DWORD index = SIMCONNECT_RECV_EXCEPTION::UNKNOWN_INDEX) {
+    auto bytes = makeMessage<SIMCONNECT_RECV_EXCEPTION>(SIMCONNECT_RECV_ID_EXCEPTION);
+    auto* msg = reinterpret_cast<SIMCONNECT_RECV_EXCEPTION*>(bytes.data());
+    msg->dwException = exception;
+    msg->dwSendID = sendId;
+    msg->dwIndex = index;
+    enqueue(std::move(bytes), false);
+  }
+
+  void queueClientData(const ClientDataRequest& request, bool onSet = false) {
+    Area* const pArea = areaById(request.areaId);
+    const auto def = clientDefinitions.find(request.defineId);
+    if (pArea == nullptr || def == clientDefinitions.end()) {
+      queueException(SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID);
+      return;
+    }
+    const DWORD size = definitionSize(def->second);
+    constexpr size_t header = DATA_HEADER_SIZE;
+    auto bytes = makeMessage<SIMCONNECT_RECV_CLIENT_DATA>(SIMCONNECT_RECV_ID_CLIENT_DATA, header + size);
+    auto* msg = reinterpret_cast<SIMCONNECT_RECV_CLIENT_DATA*>(bytes.data());
+    msg->dwRequestID = request.requestId;
+    msg->dwObjectID = SIMCONNECT_OBJECT_ID_USER;
+    msg->dwDefineID = request.defineId;
+    msg->dwentrynumber = 1;
+    msg->dwoutof = 1;
+    msg->dwDefineCount = static_cast<DWORD>(def->second.size());
+    readArea(*pArea, def->second, bytes.data() + header);
+    enqueue(std::move(bytes), true, onSet ? static_cast<int64_t>(request.requestId) : -1);
+  }
+
+  void notifyOnSet(const std::string& areaName) {
+    for (const auto& request : onSetRequests) {
+      const auto it = areaIds.find(request.areaId);
+      if (it != areaIds.end() && it->second == areaName) {
+        queueClientData(request, true);
+      }
+    }
+  }
+
+  void callPeerHandlers(const Area& area) {
+    const auto [begin, end] = peerHandlers.equal_range(area.name);
+    for (auto it = begin; it != end; ++it) {
+      it->second(area.name, area.data.data(), static_cast<DWORD>(area.data.size()));
+    }
+  }
+
+  void reset() {
+    areas.clear();
+    areaIds.clear();
+    clientDefinitions.clear();
+    simObjectDefinitionSizes.clear();
+    onSetRequests.clear();
+    queue.clear();
+    current.clear();
+    lastDue = {};
+    sendId = 0;
+    event = nullptr;
+  }
+};
+
+double envDouble(const char* name, double defaultValue) {
+  const char* value = std::getenv(name);
+  return value == nullptr ? defaultValue : std::strtod(value, nullptr);
+}
+
+}  // namespace
+
+// =========================
+// Windows helpers
+
+void Sleep(DWORD dwMilliseconds) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(dwMilliseconds));
+}
+
+HANDLE CreateEvent([[maybe_unused]] void* lpEventAttributes, BOOL bManualReset, BOOL bInitialState, [[maybe_unused]] LPCSTR lpName) {
+  return new Event(bManualReset != FALSE, bInitialState != FALSE);
+}
+
+BOOL SetEvent(HANDLE hEvent) {
+  if (hEvent == nullptr) {
+    return FALSE;
+  }
+  static_cast<Event*>(hEvent)->set();
+  return TRUE;
+}
+
+BOOL CloseHandle(HANDLE hObject) {
+  if (hObject == nullptr) {
+    return FALSE;
+  }
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (lb.event == hObject) {
+    lb.event = nullptr;
+  }
+  delete static_cast<Event*>(hObject);
+  return TRUE;
+}
+
+DWORD WaitForSingleObject(HANDLE hHandle, DWORD dwMilliseconds) {
+  if (hHandle == nullptr) {
+    return WAIT_FAILED;
+  }
+  std::optional<Clock::time_point> deadline;
+  if (dwMilliseconds != INFINITE) {
+    deadline = Clock::now() + std::chrono::milliseconds(dwMilliseconds);
+  }
+  return static_cast<Event*>(hHandle)->wait(deadline) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+}
+
+// =========================
+// SimConnect API
+
+HRESULT SimConnect_Open(HANDLE* phSimConnect,
+                        LPCSTR szName,
+                        [[maybe_unused]] HWND hWnd,
+                        [[maybe_unused]] DWORD UserEventWin32,
+                        HANDLE hEventHandle,
+                        [[maybe_unused]] DWORD ConfigIndex) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (phSimConnect == nullptr) {
+    return E_FAIL;
+  }
+  lb.reset();
+  lb.open = true;
+  lb.event = static_cast<Event*>(hEventHandle);
+  lb.rng.seed(lb.config.seed);
+  *phSimConnect = &lb;
+
+  auto bytes = Loopback::makeMessage<SIMCONNECT_RECV_OPEN>(SIMCONNECT_RECV_ID_OPEN);
+  auto* msg = reinterpret_cast<SIMCONNECT_RECV_OPEN*>(bytes.data());
+  std::strncpy(msg->szApplicationName, szName != nullptr ? szName : "", sizeof(msg->szApplicationName) - 1);
+  lb.enqueue(std::move(bytes), false);
+  return S_OK;
+}
+
+HRESULT SimConnect_Close(HANDLE hSimConnect) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect)) {
+    return E_FAIL;
+  }
+  lb.reset();
+  lb.open = false;
+  return S_OK;
+}
+
+HRESULT SimConnect_GetNextDispatch(HANDLE hSimConnect, SIMCONNECT_RECV** ppData, DWORD* pcbData) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect) || lb.queue.empty()) {
+    return E_FAIL;
+  }
+  if (lb.queue.front().due > Clock::now()) {
+    // the client stops dispatching here - wake it up again when the message is due
+    if (lb.event != nullptr) {
+      lb.event->arm(lb.queue.front().due);
+    }
+    return E_FAIL;
+  }
+  // the returned pointer stays valid until the next call - same contract as the SDK
+  lb.current = std::move(lb.queue.front().bytes);
+  lb.queue.pop_front();
+  lb.stats.messagesDelivered++;
+  lb.stats.bytesDelivered += lb.current.size();
+  *ppData = reinterpret_cast<SIMCONNECT_RECV*>(lb.current.data());
+  *pcbData = static_cast<DWORD>(lb.current.size());
+  return S_OK;
+}
+
+HRESULT SimConnect_SubscribeToSystemEvent(HANDLE hSimConnect, SIMCONNECT_CLIENT_EVENT_ID EventID, const char* SystemEventName) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect)) {
+    return E_FAIL;
+  }
+  lb.sendId++;
+  // the loopback sim is always running - confirm SimStart right away
+  if (SystemEventName != nullptr && std::strcmp(SystemEventName, "SimStart") == 0) {
+    auto bytes = Loopback::makeMessage<SIMCONNECT_RECV_EVENT>(SIMCONNECT_RECV_ID_EVENT);
+    auto* msg = reinterpret_cast<SIMCONNECT_RECV_EVENT*>(bytes.data());
+    msg->uGroupID = SIMCONNECT_RECV_EVENT::UNKNOWN_GROUP;
+    msg->uEventID = EventID;
+    lb.enqueue(std::move(bytes), false);
+  }
+  return S_OK;
+}
+
+HRESULT SimConnect_AddToDataDefinition(HANDLE hSimConnect,
+                                       SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                       [[maybe_unused]] const char* DatumName,
+                                       [[maybe_unused]] const char* UnitsName,
+                                       SIMCONNECT_DATATYPE DatumType,
+                                       [[maybe_unused]] float fEpsilon,
+                                       [[maybe_unused]] DWORD DatumID) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect)) {
+    return E_FAIL;
+  }
+  lb.sendId++;
+  // only the TITLE string is served by the loopback - other types are sized but read as zero
+  DWORD size;
+  switch (DatumType) {
+    case SIMCONNECT_DATATYPE_INT32:
+    case SIMCONNECT_DATATYPE_FLOAT32:
+      size = 4;
+      break;
+    case SIMCONNECT_DATATYPE_STRING8:
+      size = 8;
+      break;
+    case SIMCONNECT_DATATYPE_STRING32:
+      size = 32;
+      break;
+    case SIMCONNECT_DATATYPE_STRING64:
+      size = 64;
+      break;
+    case SIMCONNECT_DATATYPE_STRING128:
+      size = 128;
+      break;
+    case SIMCONNECT_DATATYPE_STRING256:
+      size = 256;
+      break;
+    case SIMCONNECT_DATATYPE_STRING260:
+      size = 260;
+      break;
+    default:
+      size = 8;
+  }
+  lb.simObjectDefinitionSizes[DefineID] += size;
+  return S_OK;
+}
+
+HRESULT SimConnect_RequestDataOnSimObject(HANDLE hSimConnect,
+                                          SIMCONNECT_DATA_REQUEST_ID RequestID,
+                                          SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                          SIMCONNECT_OBJECT_ID ObjectID,
+                                          SIMCONNECT_PERIOD Period,
+                                          [[maybe_unused]] SIMCONNECT_DATA_REQUEST_FLAG Flags,
+                                          [[maybe_unused]] DWORD origin,
+                                          [[maybe_unused]] DWORD interval,
+                                          [[maybe_unused]] DWORD limit) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect)) {
+    return E_FAIL;
+  }
+  lb.sendId++;
+  if (Period == SIMCONNECT_PERIOD_NEVER) {
+    return S_OK;
+  }
+  if (Period != SIMCONNECT_PERIOD_ONCE) {
+    // periodic sim object requests are not emulated
+    return E_FAIL;
+  }
+  const auto def = lb.simObjectDefinitionSizes.find(DefineID);
+  if (def == lb.simObjectDefinitionSizes.end()) {
+    lb.queueException(SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID);
+    return S_OK;
+  }
+  constexpr size_t header = DATA_HEADER_SIZE;
+  auto bytes = Loopback::makeMessage<SIMCONNECT_RECV_SIMOBJECT_DATA>(SIMCONNECT_RECV_ID_SIMOBJECT_DATA, header + def->second);
+  auto* msg = reinterpret_cast<SIMCONNECT_RECV_SIMOBJECT_DATA*>(bytes.data());
+  msg->dwRequestID = RequestID;
+  msg->dwObjectID = ObjectID;
+  msg->dwDefineID = DefineID;
+  msg->dwentrynumber = 1;
+  msg->dwoutof = 1;
+  msg->dwDefineCount = 1;
+  std::strncpy(bytes.data() + header, lb.config.title.c_str(), std::min<size_t>(def->second, TITLE_SIZE) - 1);
+  lb.enqueue(std::move(bytes), true);
+  return S_OK;
+}
+
+HRESULT SimConnect_MapClientDataNameToID(HANDLE hSimConnect, const char* szClientDataName, SIMCONNECT_CLIENT_DATA_ID ClientDataID) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect) || szClientDataName == nullptr) {
+    return E_FAIL;
+  }
+  lb.sendId++;
+  const auto it = lb.areaIds.find(ClientDataID);
+  if (it != lb.areaIds.end() && it->second != szClientDataName) {
+    lb.queueException(SIMCONNECT_EXCEPTION_DUPLICATE_ID);
+    return S_OK;
+  }
+  lb.area(szClientDataName);
+  lb.areaIds[ClientDataID] = szClientDataName;
+  return S_OK;
+}
+
+HRESULT SimConnect_CreateClientData(HANDLE hSimConnect,
+                                    SIMCONNECT_CLIENT_DATA_ID ClientDataID,
+                                    DWORD dwSize,
+                                    [[maybe_unused]] SIMCONNECT_CREATE_CLIENT_DATA_FLAG Flags) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect)) {
+    return E_FAIL;
+  }
+  lb.sendId++;
+  Area* const pArea = lb.areaById(ClientDataID);
+  if (pArea == nullptr) {
+    lb.queueException(SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID);
+    return S_OK;
+  }
+  if (dwSize > SIMCONNECT_CLIENTDATA_MAX_SIZE) {
+    lb.queueException(SIMCONNECT_EXCEPTION_OUT_OF_BOUNDS);
+    return S_OK;
+  }
+  Loopback::ensureSize(*pArea, dwSize);
+  return S_OK;
+}
+
+HRESULT SimConnect_AddToClientDataDefinition(HANDLE hSimConnect,
+                                             SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID,
+                                             DWORD dwOffset,
+                                             DWORD dwSizeOrType,
+                                             [[maybe_unused]] float fEpsilon,
+                                             [[maybe_unused]] DWORD DatumID) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect)) {
+    return E_FAIL;
+  }
+  lb.sendId++;
+  auto& datums = lb.clientDefinitions[DefineID];
+  if (dwOffset == static_cast<DWORD>(SIMCONNECT_CLIENTDATAOFFSET_AUTO)) {
+    dwOffset = datums.empty() ? 0 : datums.back().offset + datums.back().size;
+  }
+  if (dwOffset + dwSizeOrType > SIMCONNECT_CLIENTDATA_MAX_SIZE) {
+    lb.queueException(SIMCONNECT_EXCEPTION_OUT_OF_BOUNDS);
+    return S_OK;
+  }
+  datums.push_back({dwOffset, dwSizeOrType});
+  return S_OK;
+}
+
+HRESULT SimConnect_RequestClientData(HANDLE hSimConnect,
+                                     SIMCONNECT_CLIENT_DATA_ID ClientDataID,
+                                     SIMCONNECT_DATA_REQUEST_ID RequestID,
+                                     SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID,
+                                     SIMCONNECT_CLIENT_DATA_PERIOD Period,
+                                     [[maybe_unused]] SIMCONNECT_CLIENT_DATA_REQUEST_FLAG Flags,
+                                     [[maybe_unused]] DWORD origin,
+                                     [[maybe_unused]] DWORD interval,
+                                     [[maybe_unused]] DWORD limit) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect)) {
+    return E_FAIL;
+  }
+  lb.sendId++;
+  const ClientDataRequest request{RequestID, ClientDataID, DefineID};
+  // a new request with the same request id replaces the previous one
+  std::erase_if(lb.onSetRequests, [&](const ClientDataRequest& r) { return r.requestId == RequestID; });
+  switch (Period) {
+    case SIMCONNECT_CLIENT_DATA_PERIOD_NEVER:
+      return S_OK;
+    case SIMCONNECT_CLIENT_DATA_PERIOD_ONCE:
+      lb.queueClientData(request);
+      return S_OK;
+    case SIMCONNECT_CLIENT_DATA_PERIOD_ON_SET:
+      lb.onSetRequests.push_back(request);
+      return S_OK;
+    default:
+      // frame and second based periods are not emulated
+      return E_FAIL;
+  }
+}
+
+HRESULT SimConnect_SetClientData(HANDLE hSimConnect,
+                                 SIMCONNECT_CLIENT_DATA_ID ClientDataID,
+                                 SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID,
+                                 [[maybe_unused]] SIMCONNECT_CLIENT_DATA_SET_FLAG Flags,
+                                 [[maybe_unused]] DWORD dwReserved,
+                                 DWORD cbUnitSize,
+                                 void* pDataSet) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  if (!lb.isValid(hSimConnect) || pDataSet == nullptr) {
+    return E_FAIL;
+  }
+  lb.sendId++;
+  Area* const pArea = lb.areaById(ClientDataID);
+  const auto def = lb.clientDefinitions.find(DefineID);
+  if (pArea == nullptr || def == lb.clientDefinitions.end()) {
+    lb.queueException(SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID);
+    return S_OK;
+  }
+  if (cbUnitSize != Loopback::definitionSize(def->second)) {
+    lb.queueException(SIMCONNECT_EXCEPTION_SIZE_MISMATCH);
+    return S_OK;
+  }
+  lb.stats.clientSetCalls++;
+  lb.stats.clientSetBytes += cbUnitSize;
+
+  const auto* const src = static_cast<const char*>(pDataSet);
+  Loopback::writeArea(*pArea, def->second, src);
+  lb.notifyOnSet(pArea->name);
+
+  const auto mirror = lb.mirrors.find(pArea->name);
+  if (mirror != lb.mirrors.end()) {
+    Area& target = lb.area(mirror->second);
+    Loopback::writeArea(target, def->second, src);
+    lb.notifyOnSet(target.name);
+  }
+  lb.callPeerHandlers(*pArea);
+  return S_OK;
+}
+
+// =========================
+// Loopback control
+
+namespace SimConnectLoopback {
+
+Config Config::fromEnvironment() {
+  Config config{};
+  config.latency = std::chrono::microseconds(static_cast<int64_t>(envDouble("LOOPBACK_LATENCY_US", 0.0)));
+  config.jitter = std::chrono::microseconds(static_cast<int64_t>(envDouble("LOOPBACK_JITTER_US", 0.0)));
+  config.bandwidth = envDouble("LOOPBACK_BANDWIDTH", 0.0);
+  config.dropRate = std::clamp(envDouble("LOOPBACK_DROP_RATE", 0.0), 0.0, 1.0);
+  config.seed = static_cast<uint32_t>(envDouble("LOOPBACK_SEED", 0.0));
+  config.framePeriod = std::chrono::microseconds(static_cast<int64_t>(envDouble("LOOPBACK_FRAME_US", 0.0)));
+  return config;
+}
+
+void configure(const Config& config) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  lb.config = config;
+  lb.rng.seed(config.seed);
+}
+
+Config configuration() {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  return lb.config;
+}
+
+Stats stats() {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  return lb.stats;
+}
+
+void resetStats() {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  lb.stats = {};
+}
+
+void mirrorClientData(const std::string& fromAreaName, const std::string& toAreaName) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  lb.mirrors[fromAreaName] = toAreaName;
+}
+
+void onClientSetData(const std::string& areaName, PeerHandler handler) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  lb.peerHandlers.emplace(areaName, std::move(handler));
+}
+
+void peerSetClientData(const std::string& areaName, const void* data, DWORD size, DWORD offset) {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  Area& area = lb.area(areaName);
+  Loopback::ensureSize(area, offset + size);
+  std::memcpy(area.data.data() + offset, data, size);
+  lb.notifyOnSet(areaName);
+}
+
+void requestQuit() {
+  auto& lb = Loopback::instance();
+  std::lock_guard lock(lb.mutex);
+  lb.enqueue(Loopback::makeMessage<SIMCONNECT_RECV_QUIT>(SIMCONNECT_RECV_ID_QUIT), false);
+}
+
+}  // namespace SimConnectLoopback
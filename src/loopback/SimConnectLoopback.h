@@ -0,0 +1,109 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_LOOPBACK_SIMCONNECTLOOPBACK_H
+#define FBW_CPP_FRAMEWORK_TEST_LOOPBACK_SIMCONNECTLOOPBACK_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "SimConnect.h"
+
+/**
+ * Control interface of the in-process SimConnect loopback.
+ *
+ * The loopback plays the simulator side of the connection. It keeps the client data areas in
+ * memory, answers ONCE and ON_SET requests and delivers every message through a simulated link
+ * with configurable latency, bandwidth and drop rate. The peer functions below allow a test or
+ * benchmark to act as the WASM module on the other side of the client data areas.
+ *
+ * Usage:
+ *
+ * SimConnectLoopback::configure(SimConnectLoopback::Config::fromEnvironment());
+ * SimConnectLoopback::mirrorClientData("STREAM RECEIVER DATA", "STREAM SENDER DATA");
+ */
+namespace SimConnectLoopback {
+
+/**
+ * Link simulation parameters applied to every message delivered to the client.
+ */
+struct Config {
+  /** fixed latency added to every message */
+  std::chrono::microseconds latency{0};
+  /** random additional latency in [0, jitter] */
+  std::chrono::microseconds jitter{0};
+  /** link bandwidth in bytes per second - 0 means unlimited */
+  double bandwidth = 0.0;
+  /** probability [0..1] that a data message is lost on the link */
+  double dropRate = 0.0;
+  /**
+   * sim frame period - ON_SET data is delivered on frame boundaries and an area set several times within
+   * one frame is only delivered once with its latest content (0 = deliver every set)
+   */
+  std::chrono::microseconds framePeriod{0};
+  /** seed for the jitter and drop random generator */
+  uint32_t seed = 0;
+  /** value returned for the TITLE sim variable */
+  std::string title = "Loopback Aircraft";
+
+  /**
+   * Reads the configuration from the environment variables LOOPBACK_LATENCY_US, LOOPBACK_JITTER_US,
+   * LOOPBACK_BANDWIDTH (bytes/sec), LOOPBACK_DROP_RATE, LOOPBACK_FRAME_US and LOOPBACK_SEED. Unset variables keep their default.
+   */
+  static Config fromEnvironment();
+};
+
+/**
+ * Counters of the loopback link.
+ */
+struct Stats {
+  uint64_t messagesQueued = 0;
+  uint64_t messagesDelivered = 0;
+  uint64_t messagesDropped = 0;
+  uint64_t messagesCoalesced = 0;
+  uint64_t bytesDelivered = 0;
+  uint64_t clientSetCalls = 0;
+  uint64_t clientSetBytes = 0;
+};
+
+/**
+ * Called when the client has written to a client data area.
+ * Receives the area name, the full area content and its size.
+ */
+using PeerHandler = std::function<void(const std::string& areaName, const char* data, DWORD size)>;
+
+/** Sets the link parameters. Can be called at any time and applies to messages queued afterwards. */
+void configure(const Config& config);
+
+/** @return the current link parameters */
+Config configuration();
+
+/** @return a snapshot of the link counters */
+Stats stats();
+
+/** Resets the link counters to zero. */
+void resetStats();
+
+/**
+ * Lets the peer re-publish every client write to the area fromAreaName into the area toAreaName.
+ * This emulates a WASM module echoing data back and allows round trip streaming without a sim.
+ */
+void mirrorClientData(const std::string& fromAreaName, const std::string& toAreaName);
+
+/** Registers a handler which is called on every client write to the given area. */
+void onClientSetData(const std::string& areaName, PeerHandler handler);
+
+/**
+ * Writes data into a client data area as the peer would do and notifies all ON_SET requests of the area.
+ * The area is created if it does not exist yet.
+ */
+void peerSetClientData(const std::string& areaName, const void* data, DWORD size, DWORD offset = 0);
+
+/** Queues a SIMCONNECT_RECV_ID_QUIT message to end the client's loop. */
+void requestQuit();
+
+}  // namespace SimConnectLoopback
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_LOOPBACK_SIMCONNECTLOOPBACK_H
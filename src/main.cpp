@@ -1,66 +1,148 @@
 #include <iostream>
 
+#ifdef _WIN32
 #include <strsafe.h>
 #include <windows.h>
+#endif
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
+#include <memory>
 #include <random>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "SimConnect.h"
+#ifndef _WIN32
+#include "SimConnectLoopback.h"
+#endif
 
 #include "SimconnectExceptionStrings.h"
+#include "bufferpool.h"
+#include "chrometrace.h"
+#include "clientdataarea.h"
+#include "clientdatadelta.h"
+#include "dispatcher.h"
+#include "filestream.h"
 #include "fingerprint.h"
 #include "logging.h"
 #include "longtext.h"
-
-static const int loopThrottleValue = 100000000;
+#include "metrics.h"
+#include "scheduler.h"
+#include "sendqueue.h"
+#include "slidingwindow.h"
+#include "spscring.h"
+#include "streamdemultiplexer.h"
+#include "streamprotocol.h"
+#include "streamreassembler.h"
+#include "streamsink.h"
+#include "trackedclientdata.h"
+#include "threadpool.h"
+#include "tracelog.h"
+#include "trafficcapture.h"
+#include "treefingerprint.h"
+
+// periods of the scheduled jobs - the main loop sleeps on the SimConnect event handle in between
+static const std::chrono::milliseconds titleRequestPeriod{5000};
+static const std::chrono::milliseconds exampleClientDataPeriod{1000};
+static const std::chrono::milliseconds bigClientDataPeriod{1000};
+static const std::chrono::milliseconds streamSendPeriod{5000};
+static const std::chrono::milliseconds urgentStreamSendPeriod{1700};
+static const std::chrono::milliseconds fileStreamSendPeriod{10000};
+static const std::chrono::milliseconds outputPeriod{5000};
+// how often the counts of suppressed rate limited log messages are reported if their call sites stay silent
+static const std::chrono::milliseconds logSuppressedReportPeriod{10000};
+// longest wait for SimConnect messages - bounds the reaction time to quit without a message
+static const DWORD maxWaitMs = 1000;
+// max. bytes of client data writes sent per loop iteration - the rest is sent in the next iteration
+static const size_t sendBudgetBytesPerTick = 256 * 1024;
+// log through a background writer thread so logging never blocks the loop - messages are dropped when the ring is full
+// off by default: the log lines would then appear out of order with the output written to std::cout
+static const bool asyncLogging = false;
+static const size_t asyncLogCapacity = 4096;
+// pull SimConnect messages on a dedicated thread into a ring - the main thread only processes and sends
+static const bool receiveThreadMode = true;
+// preallocated size of the receive ring - holds several full streams of chunks
+static const size_t receiveRingSize = 4 * 1024 * 1024;
+// binary trace of the protocol events for post-mortem analysis when FBW_TRACE_FILE names a file - decode with trace-decode
+static const uint64_t traceRecords = 64 * 1024;
+// metrics snapshots appended as JSON lines for graphing when FBW_METRICS_FILE names a file
+static const std::chrono::milliseconds metricsPeriod{1000};
+// Chrome trace of the dispatch and stream phases - recorded from the start for chromeTraceDuration when FBW_CHROME_TRACE names
+// the file, open it in chrome://tracing or Perfetto
+static const std::chrono::seconds chromeTraceDuration{20};
+static const size_t chromeTraceCapacity = 200000;
+// capture of the SimConnect traffic when FBW_CAPTURE_FILE names the file - FBW_REPLAY_FILE replays such a file instead of
+// connecting, FBW_REPLAY_PACING=recorded at the captured pace instead of as fast as possible
+static const size_t trafficCaptureBufferBytes = 1024 * 1024;
+static const std::chrono::milliseconds trafficCaptureFlushPeriod{1000};
+// send a fingerprint per chunk ahead of the stream data so corrupt chunks can be identified
+static const bool streamTreeFingerprintMode = false;
+// max. number of unacknowledged stream chunks in flight - 0 sends all chunks without acknowledgement
+static const uint32_t streamAckWindow = 0;
+// resend all unacknowledged chunks when no ack arrived for this long
+static const std::chrono::milliseconds streamAckTimeout{100};
+// number of data areas stream chunks are distributed over round-robin - the sim publishes each area once per frame
+static const uint32_t streamStripeCount = 1;
+static_assert(streamStripeCount >= 1);
+// compression of the stream data on the wire - falls back to NONE if the data does not get smaller
+static const StreamCompression streamCompression = StreamCompression::NONE;
+// stream IDs of the outgoing streams - the small urgent stream is sent while the long one is in progress
+static const uint32_t longStreamId = 1;
+static const uint32_t urgentStreamId = 2;
+static const size_t urgentStreamSize = 2000;
+// FBW_STREAM_FILE=<file> sends the file from a memory mapping as stream fileStreamId and receives it into <file>.received
+static const uint32_t fileStreamId = 3;
+static const char* const fileStreamReceivedSuffix = ".received";
+// bytes of the sent file read ahead of the current chunk and of the received file written before it is flushed
+static const size_t fileStreamReadAheadBytes = 4 * 1024 * 1024;
+static const size_t fileStreamFlushBytes = 8 * 1024 * 1024;
+// without ack window stream chunks are only queued while the send queue holds fewer writes - large streams are never copied
+// into the queue as a whole
+static const size_t streamMaxQueuedWrites = 64;
+// max. number of received streams in progress at the same time - further streams are rejected
+static const size_t maxConcurrentStreams = 4;
+// max. bytes of free stream buffers kept for the next received streams
+static const size_t streamBufferPoolBytes = 4 * 1024 * 1024;
+// BIG CLIENT DATA is written in pages - only changed pages are sent, dirty runs at most this many clean pages apart are merged
+static const uint32_t bigClientDataPageSize = 512;
+static const uint32_t bigClientDataMaxGapPages = 1;
+// number of definition IDs reserved for writing only the changed span of EXAMPLE 2 CLIENT DATA
+static const uint32_t example2SpanDefinitions = 8;
 
 int quit = 0;
 bool initilized = false;
-uint64_t loopCounter = 0;
+uint64_t wakeUps = 0;
 
 typedef double FLOAT64;
 typedef float FLOAT32;
 
 HANDLE hSimConnect = nullptr;
+// signaled by SimConnect when messages are available
+HANDLE hSimConnectEvent = nullptr;
+// signaled by the receive thread when it has put messages into the receive ring
+HANDLE hReceivedEvent = nullptr;
 
 enum EVENT_IDS {
   EVENT_SIM_START,
 };
 
-enum CLIENT_DATA_IDS {
-  EXAMPLE_CLIENT_DATA_ID,
-  EXAMPLE2_CLIENT_DATA_ID,
-  BIG_CLIENT_DATA_ID,
-  STREAM_RECEIVER_META_DATA_ID,  // sim is receiving
-  STREAM_RECEIVER_DATA_ID,       // sim is receiving
-  STREAM_SENDER_META_DATA_ID,    // sim is sending
-  STREAM_SENDER_DATA_ID,         // sim is sending
-};
-
 enum DATA_DEFINE_IDS {
   TITLE_DEFINITION_ID,
-  EXAMPLE_CLIENT_DATA_DEFINITION_ID,
-  EXAMPLE2_CLIENT_DATA_DEFINITION_ID,
-  BIG_CLIENT_DATA_DEFINITION_ID,
-  STREAM_RECEIVER_META_DATA_DEFINITION_ID,
-  STREAM_RECEIVER_DATA_DEFINITION_ID,
-  STREAM_SENDER_META_DATA_DEFINITION_ID,
-  STREAM_SENDER_DATA_DEFINITION_ID,
+  FIRST_CLIENT_DATA_DEFINITION_ID,  // client data definition IDs are assigned by the ClientDataRegistry from here on
 };
 
 enum DATA_REQUEST_IDS {
   TITLE_REQUEST_ID,
-  EXAMPLE_CLIENT_DATA_REQUEST_ID,
-  EXAMPLE2_CLIENT_DATA_REQUEST_ID,
-  BIG_CLIENT_DATA_REQUEST_ID,
-  STREAM_RECEIVER_META_DATA_REQUEST_ID,
-  STREAM_RECEIVER_DATA_REQUEST_ID,
-  STREAM_SENDER_META_DATA_REQUEST_ID,
-  STREAM_SENDER_DATA_REQUEST_ID,
+  FIRST_CLIENT_DATA_REQUEST_ID,  // client data request IDs are assigned by the ClientDataRegistry from here on
 };
 
 // Title string sim variable
@@ -68,6 +150,12 @@ struct Title {
   [[maybe_unused]] char title[256] = "";
 } title{};
 
+// all client data areas - each area is declared once below and registered with SimConnect in initialize()
+ClientDataRegistry& clientDataRegistry() {
+  static ClientDataRegistry registry{FIRST_CLIENT_DATA_DEFINITION_ID, FIRST_CLIENT_DATA_REQUEST_ID};
+  return registry;
+}
+
 // ClientDataArea variables
 const std::string EXAMPLE_CLIENT_DATA_NAME = "EXAMPLE CLIENT DATA";
 struct ExampleClientData {
@@ -78,7 +166,11 @@ struct ExampleClientData {
   INT16 anInt16;
   INT8 anInt8;
 } __attribute__((packed)) exampleClientData{};
-const size_t exampleClientDataSize = sizeof(ExampleClientData);
+const auto& exampleClientDataArea = clientDataRegistry().add<ExampleClientData, 27>(
+    EXAMPLE_CLIENT_DATA_NAME, ClientDataDirection::REQUEST, [](const ExampleClientData& data) {
+      LOGF_INFO("Received client data: {}", EXAMPLE_CLIENT_DATA_NAME);
+      exampleClientData = data;
+    });
 
 // ClientDataArea variables
 const std::string EXAMPLE2_CLIENT_DATA_NAME = "EXAMPLE 2 CLIENT DATA";
@@ -89,53 +181,185 @@ struct Example2ClientData {
   INT64 anInt64;
   FLOAT32 aFloat32;
   FLOAT64 aFloat64;
-} __attribute__((packed)) example2ClientData{};
-const size_t example2ClientDataSize = sizeof(Example2ClientData);
+} __attribute__((packed));
+const auto& example2ClientDataArea = clientDataRegistry().add<Example2ClientData, 27>(EXAMPLE2_CLIENT_DATA_NAME, ClientDataDirection::SEND);
+TrackedClientData<Example2ClientData> example2ClientData(example2ClientDataArea.id(), example2ClientDataArea.definitionId(),
+                                                         clientDataRegistry().reserveDefinitionIds(example2SpanDefinitions),
+                                                         example2SpanDefinitions);
 
 // Big ClientDataArea variable
 const std::string BIG_CLIENT_DATA_NAME = "BIG CLIENT DATA";
 struct BigClientData {
   std::array<char, SIMCONNECT_CLIENTDATA_MAX_SIZE> dataChunk;
 } __attribute__((packed)) bigClientData{};
+const auto& bigClientDataArea = clientDataRegistry().add<BigClientData, SIMCONNECT_CLIENTDATA_MAX_SIZE>(BIG_CLIENT_DATA_NAME,
+                                                                                                        ClientDataDirection::SEND);
+constexpr uint32_t bigClientDataPages = (sizeof(BigClientData) + bigClientDataPageSize - 1) / bigClientDataPageSize;
+ClientDataDeltaWriter bigClientDataWriter(bigClientDataArea.id(), bigClientDataArea.definitionId(),
+                                          clientDataRegistry().reserveDefinitionIds(bigClientDataPages), sizeof(bigClientData),
+                                          bigClientDataPageSize, bigClientDataMaxGapPages);
+
+// one chunk of a stream data area
+struct StreamChunk {
+  char data[StreamChunkSize];
+} __attribute__((packed));
+
+void processStreamMetaData(const StreamMetaData& metaData);
+void processStreamData(const StreamChunk& chunk);
+void processStreamReceiverAck(const StreamAck& ack);
+
+/** @return client data area name of the given stripe of a stream data area - stripe 0 is the unstriped area */
+std::string streamStripeName(const std::string& areaName, uint32_t stripe) {
+  return stripe == 0 ? areaName : areaName + " " + std::to_string(stripe);
+}
+
+/** Declares the stripes of a stream data area. */
+std::vector<const ClientDataArea<StreamChunk>*> addStreamStripes(const std::string& areaName,
+                                                                 ClientDataDirection direction,
+                                                                 const ClientDataArea<StreamChunk>::Handler& handler = nullptr) {
+  std::vector<const ClientDataArea<StreamChunk>*> stripes;
+  for (uint32_t stripe = 0; stripe < streamStripeCount; stripe++) {
+    stripes.push_back(&clientDataRegistry().add<StreamChunk>(streamStripeName(areaName, stripe), direction, handler));
+  }
+  return stripes;
+}
 
 // ==============================
 // STREAM RECEIVER DATA meta data
 // sending to sim - sim is receiving
 
-struct StreamMetaData {
-  size_t size;
-  size_t hash;
-} __attribute__((packed));
-
-StreamMetaData streamReceiverMetaData{};
 const std::string STREAM_RECEIVER_META_DATA_NAME = "STREAM RECEIVER META DATA";
-const size_t streamReceiverMetaDataSize = sizeof(StreamMetaData);
+const auto& streamReceiverMetaDataArea = clientDataRegistry().add<StreamMetaData>(STREAM_RECEIVER_META_DATA_NAME, ClientDataDirection::SEND);
 
-// STREAM RECEIVER DATA area
+// STREAM RECEIVER DATA area and its stripes
 const std::string STREAM_RECEIVER_DATA_NAME = "STREAM RECEIVER DATA";
+const auto streamReceiverDataAreas = addStreamStripes(STREAM_RECEIVER_DATA_NAME, ClientDataDirection::SEND);
 constexpr DWORD ChunkSize = SIMCONNECT_CLIENTDATA_MAX_SIZE;
+static_assert(ChunkSize == StreamChunkSize);
 const size_t streamReceiverDataSize = longText.size();
 const size_t streamReceiverDataSizeInBytes = streamReceiverDataSize * sizeof(char);
 std::size_t streamReceiverDataHash;
 std::vector<char> streamReceiverData{};
+std::vector<char> streamReceiverCompressedData{};
+TreeFingerprint streamReceiverTreeFingerprint{};
+// data of the urgent stream - the start of the long text
+std::vector<char> streamReceiverUrgentData{};
+
+// the file sent with FBW_STREAM_FILE - mapped, never loaded as a whole
+FileSource streamReceiverFileSource{fileStreamReadAheadBytes};
+uint64_t streamReceiverFileHash = 0;
+
+/** @return stream bytes per chunk of the outgoing stream with the given ID - also the leaf size of its tree fingerprint */
+size_t streamReceiverPayloadSize(uint32_t streamId) {
+  StreamMetaData metaData{};
+  metaData.streamId = streamId;
+  metaData.ackWindow = streamAckWindow;
+  metaData.stripeCount = streamStripeCount;
+  return streamChunkPayloadSize(hasChunkHeader(metaData));
+}
+
+/**
+ * An outgoing stream - streams with different IDs are sent concurrently over the same areas.
+ * The chunks refer to the stream data in place - in tree mode the chunk hashes precede the data.
+ */
+struct OutgoingStream {
+  explicit OutgoingStream(uint32_t id) : id(id) {}
+
+  /** @return data and size of the payload of a chunk - a chunk holds either chunk hashes or data */
+  [[nodiscard]] std::pair<const char*, size_t> chunk(uint32_t sequence) const {
+    const bool isHashChunk = sequence < hashChunkCount;
+    const auto part = isHashChunk ? hashData : wireData;
+    const size_t offset = (isHashChunk ? sequence : sequence - hashChunkCount) * payloadSize;
+    return {part.data() + offset, std::min(payloadSize, part.size() - offset)};
+  }
+
+  /** @return true until all chunks are queued - with ack window until all chunks are acknowledged */
+  [[nodiscard]] bool isSending() const { return window.isActive() || nextChunk < chunkCount; }
+
+  const uint32_t id;
+  StreamMetaData metaData{};
+  std::span<const char> hashData{};
+  std::span<const char> wireData{};
+  size_t payloadSize = StreamChunkSize;
+  uint32_t hashChunkCount = 0;
+  uint32_t chunkCount = 0;
+  // next chunk to queue without ack window
+  uint32_t nextChunk = 0;
+  // file the data is mapped from - nullptr for data in memory
+  FileSource* source = nullptr;
+  SlidingWindowSender window{streamAckWindow, streamAckTimeout};
+};
+OutgoingStream streamReceiverLongStream{longStreamId};
+OutgoingStream streamReceiverUrgentStream{urgentStreamId};
+OutgoingStream streamReceiverFileStream{fileStreamId};
+const std::array<OutgoingStream*, 3> streamReceiverStreams{&streamReceiverLongStream, &streamReceiverUrgentStream,
+                                                           &streamReceiverFileStream};
+
+// STREAM RECEIVER ACK DATA area
+const std::string STREAM_RECEIVER_ACK_DATA_NAME = "STREAM RECEIVER ACK DATA";
+const auto& streamReceiverAckArea =
+    clientDataRegistry().add<StreamAck>(STREAM_RECEIVER_ACK_DATA_NAME, ClientDataDirection::RECEIVE, processStreamReceiverAck);
 
 // ============================
 // STREAM SENDER META DATA
 // receiving from sim - sim is sending
-StreamMetaData streamSenderMetaData{};
 const std::string STREAM_SENDER_META_DATA_NAME = "STREAM SENDER META DATA";
-const size_t streamSenderMetaDataSize = sizeof(StreamMetaData);
+const auto& streamSenderMetaDataArea =
+    clientDataRegistry().add<StreamMetaData>(STREAM_SENDER_META_DATA_NAME, ClientDataDirection::RECEIVE, processStreamMetaData);
 
-// STREAM RECEIVER DATA 2 area
+// STREAM SENDER DATA area and its stripes
 const std::string STREAM_SENDER_DATA_NAME = "STREAM SENDER DATA";
-std::vector<char> streamSenderData{};
-std::size_t receivedBytes = 0;
-std::size_t expectedByteCount = 0;
-int receivedChunks = 0;
+const auto streamSenderDataAreas = addStreamStripes(STREAM_SENDER_DATA_NAME, ClientDataDirection::RECEIVE, processStreamData);
+// reassembly buffers of received streams and their decompressed data - kept between streams so steady streaming does not allocate
+BufferPool streamBufferPool{streamBufferPoolBytes};
+// received streams by stream ID - a new stream only restarts the stream with its ID
+StreamDemultiplexer streamSenderStreams{&streamBufferPool, maxConcurrentStreams};
+// the urgent stream is written straight into this buffer - it needs neither a stream buffer nor a copy
+std::array<char, urgentStreamSize> streamSenderUrgentData{};
+BufferSink streamSenderUrgentSink{streamSenderUrgentData.data(), streamSenderUrgentData.size()};
+// the file stream is received into a mapped file - created with FBW_STREAM_FILE
+std::unique_ptr<FileSink> streamSenderFileSink{};
+
+// STREAM SENDER ACK DATA area
+const std::string STREAM_SENDER_ACK_DATA_NAME = "STREAM SENDER ACK DATA";
+const auto& streamSenderAckArea = clientDataRegistry().add<StreamAck>(STREAM_SENDER_ACK_DATA_NAME, ClientDataDirection::SEND);
+
+// routes received SimConnect messages to their handlers - see registerDispatchHandlers()
+Dispatcher dispatcher{};
+// periodic jobs of the main loop - see scheduleJobs()
+Scheduler scheduler{};
+// client data writes of the current loop iteration - flushed at its end
+SendQueue sendQueue{};
+
+// hot path metrics - the remaining metrics are collected from existing statistics, see collectMetrics()
+MetricsRegistry::Counter& dispatchedMessages = metrics->counter("dispatch.messages");
+MetricsRegistry::Counter& dispatchedBytes = metrics->counter("dispatch.bytes");
+MetricsRegistry::Counter& streamSentChunks = metrics->counter("stream.sent_chunks");
+MetricsRegistry::Counter& streamSentBytes = metrics->counter("stream.sent_bytes");
+MetricsRegistry::Counter& streamReceivedChunks = metrics->counter("stream.received_chunks");
+MetricsRegistry::Counter& streamReceivedBytes = metrics->counter("stream.received_bytes");
+// from the meta data to the last chunk of a received stream
+MetricsRegistry::Histogram& streamReassemblyTime = metrics->histogram("stream.reassembly_time");
+// verification of a received stream - fingerprint or chunk hash tree
+MetricsRegistry::Histogram& streamHashTime = metrics->histogram("stream.hash_time");
+std::ofstream metricsFile{};
+
+// log module of the stream protocol - its level can be set on its own, e.g. FBW_LOG_LEVELS="info,stream=warn"
+LogModule& streamLog() {
+  static LogModule& module = logger->module("stream");
+  return module;
+}
+
+// lazily started so the threads only exist when tree fingerprints are used
+ThreadPool& verificationPool() {
+  static ThreadPool pool{};
+  return pool;
+}
 
 void initialize() {
   if (initilized)
     return;
+  TRACE_SPAN("initialize", "init");
 
   LOG_INFO("Initializing SimConnect connection");
 
@@ -147,493 +371,698 @@ void initialize() {
     LOG_ERROR("Failed to add definition for Title");
   }
 
-  // =========================
-  // EXAMPLE CLIENT DATA
-
-  // Map the client data area EXAMPLE_CLIENT_DATA_NAME to the client data area ID
-  HRESULT hresult = SimConnect_MapClientDataNameToID(hSimConnect, EXAMPLE_CLIENT_DATA_NAME.c_str(), EXAMPLE_CLIENT_DATA_ID);
-  if (hresult != S_OK) {
-    switch (hresult) {
-      case SIMCONNECT_EXCEPTION_ALREADY_CREATED:
-        LOG_ERROR("Client data area EXAMPLE_CLIENT_DATA_NAME already in use: " + EXAMPLE_CLIENT_DATA_NAME);
-        break;
-      case SIMCONNECT_EXCEPTION_DUPLICATE_ID:
-        LOG_ERROR("Client data area ID already in use: " + std::to_string(EXAMPLE_CLIENT_DATA_ID));
-        break;
-      default:
-        LOG_ERROR("Mapping client data area EXAMPLE_CLIENT_DATA_NAME to ID failed: " + EXAMPLE_CLIENT_DATA_NAME);
-    }
-  }
-
-  // Add the data definition to the client data area
-  if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, EXAMPLE_CLIENT_DATA_DEFINITION_ID, SIMCONNECT_CLIENTDATAOFFSET_AUTO,
-                                                      exampleClientDataSize))) {
-    LOG_ERROR("ClientDataAreaVariable: Adding to client data definition failed: " + EXAMPLE_CLIENT_DATA_NAME);
+  // map, define and create or request all client data areas in one pass
+  if (!clientDataRegistry().registerAll(hSimConnect)) {
+    LOG_ERROR("Registering client data areas failed");
   }
+  // the sim side content of these areas is unknown after a failed queued write - write them as a whole again
+  sendQueue.onFailed(example2ClientDataArea.id(), [] { example2ClientData.markStale(); });
+  sendQueue.onFailed(bigClientDataArea.id(), [] { bigClientDataWriter.markStale(); });
 
-  // =========================
-  // EXAMPLE 2 CLIENT DATA
+  initilized = true;
+  LOG_INFO("SimConnect connection initialized");
+}
 
-  // Map the client data area EXAMPLE2_CLIENT_DATA_NAME to the client data area ID
-  hresult = SimConnect_MapClientDataNameToID(hSimConnect, EXAMPLE2_CLIENT_DATA_NAME.c_str(), EXAMPLE2_CLIENT_DATA_ID);
-  if (hresult != S_OK) {
-    switch (hresult) {
-      case SIMCONNECT_EXCEPTION_ALREADY_CREATED:
-        LOG_ERROR("Client data area EXAMPLE2_CLIENT_DATA_NAME already in use: " + EXAMPLE2_CLIENT_DATA_NAME);
-        break;
-      case SIMCONNECT_EXCEPTION_DUPLICATE_ID:
-        LOG_ERROR("Client data area ID already in use: " + std::to_string(EXAMPLE2_CLIENT_DATA_ID));
-        break;
-      default:
-        LOG_ERROR("Mapping client data area EXAMPLE2_CLIENT_DATA_NAME to ID failed: " + EXAMPLE2_CLIENT_DATA_NAME);
+/**
+ * Verifies a completely received stream against its meta data and prints the result.
+ * @param streamSenderData the stream data - decompressed if the stream was compressed
+ */
+void verifyStreamSenderData(uint32_t streamId, const StreamReassembler& stream, std::span<const char> streamSenderData) {
+  const auto& metaData = stream.metaData();
+  const auto& streamSenderChunkHashes = stream.chunkHashes();
+  std::cout << "Received all stream data: " << STREAM_SENDER_DATA_NAME << " stream " << streamId << std::endl;
+  const auto hashStart = std::chrono::steady_clock::now();
+  if (!streamSenderChunkHashes.empty()) {
+    const bool rootMatch = treeRoot(streamSenderChunkHashes, metaData.algorithm) == metaData.hash;
+    // the leaves are the payloads of the data chunks - leaf i is data chunk i, sent after the chunks holding the hashes
+    const size_t leafSize = streamChunkPayloadSize(hasChunkHeader(metaData));
+    const auto corruptChunks = [&] {
+      TRACE_SPAN("find corrupt chunks", "stream");
+      return findCorruptChunks(streamSenderData.data(), streamSenderData.size(), leafSize, streamSenderChunkHashes, metaData.algorithm,
+                               verificationPool());
+    }();
+    streamHashTime.record(std::chrono::steady_clock::now() - hashStart);
+    std::cout << "STREAM SENDER DATA: "
+              << " stream = " << streamId << " size = " << streamSenderData.size() << " bytes = " << stream.receivedBytes()
+              << " chunks = " << stream.receivedChunks() << " root = " << std::setw(21) << metaData.hash
+              << " (root match = " << std::boolalpha << rootMatch << ", corrupt chunks = " << corruptChunks.size() << ")" << std::endl;
+    traceLog->record(TraceEvent::STREAM_RECEIVE_COMPLETED, streamId, 0, streamSenderData.size(), rootMatch);
+    for (const auto index : corruptChunks) {
+      traceLog->record(TraceEvent::STREAM_CORRUPT_CHUNK, streamId, static_cast<uint32_t>(index));
     }
+    if (!corruptChunks.empty()) {
+      std::string indexes;
+      for (const auto index : corruptChunks) {
+        indexes += (indexes.empty() ? "" : ", ") + std::to_string(index);
+      }
+      LOGM_WARN(streamLog(), "Corrupt chunks in {} stream {}: {}", STREAM_SENDER_DATA_NAME, streamId, indexes);
+    }
+    return;
   }
-
-  // Add the data definition to the client data area
-  if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, EXAMPLE2_CLIENT_DATA_DEFINITION_ID, SIMCONNECT_CLIENTDATAOFFSET_AUTO,
-                                                      example2ClientDataSize))) {
-    LOG_ERROR("Adding to client data definition failed: " + EXAMPLE2_CLIENT_DATA_NAME);
+  const uint64_t fingerPrint = [&] {
+    TRACE_SPAN("fingerprint", "stream");
+    return metaData.compression == StreamCompression::NONE ? stream.digest()
+                                                           : fingerprint(streamSenderData.data(), streamSenderData.size(), metaData.algorithm);
+  }();
+  streamHashTime.record(std::chrono::steady_clock::now() - hashStart);
+  std::cout << "STREAM SENDER DATA: "
+            << " stream = " << streamId << " size = " << streamSenderData.size() << " bytes = " << stream.receivedBytes()
+            << " chunks = " << stream.receivedChunks() << " duplicates = " << stream.duplicateChunks() << " fingerprint = " << std::setw(21)
+            << fingerPrint << " (match = " << std::boolalpha << (fingerPrint == metaData.hash) << ")" << std::endl;
+  traceLog->record(TraceEvent::STREAM_RECEIVE_COMPLETED, streamId, 0, streamSenderData.size(),
+                   fingerPrint == metaData.hash);
+  if (!streamSenderData.empty()) {
+    std::cout << "Content: "
+              << "[" << std::string(streamSenderData.begin(), streamSenderData.begin() + std::min<std::ptrdiff_t>(100, streamSenderData.size()))
+              << " ... ]" << std::endl;
   }
+}
 
-  // Create/allocate the client data area
-  if (!SUCCEEDED(SimConnect_CreateClientData(hSimConnect, EXAMPLE2_CLIENT_DATA_ID, example2ClientDataSize,
-                                             SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT))) {
-    LOG_ERROR("Creating client data failed: " + EXAMPLE2_CLIENT_DATA_NAME);
+/**
+ * Called by the stream demultiplexer after every chunk of a received stream.
+ */
+void onStreamSenderProgress(uint32_t streamId, const StreamReassembler& stream) {
+  traceLog->record(TraceEvent::STREAM_CHUNK_RECEIVED, streamId, stream.receivedChunks(), stream.receivedBytes());
+  if (stream.metaData().ackWindow > 0) {
+    // acks are cumulative - only the latest of a loop iteration is sent per stream
+    streamSenderAckArea.set(sendQueue, StreamAck{stream.ackedChunks(), streamId}, SendMode::MERGE, streamId);
   }
+  //  std::cout << "Received data chunk " << stream.receivedChunks() << " Byte received: " << STREAM_SENDER_DATA_NAME
+  //            << " (" << stream.receivedBytes() << "/" << stream.metaData().size << ") " << std::endl;
+}
 
-  // =========================
-  // BIG CLIENT DATA
-
-  hresult = SimConnect_MapClientDataNameToID(hSimConnect, BIG_CLIENT_DATA_NAME.c_str(), BIG_CLIENT_DATA_ID);
-  if (hresult != S_OK) {
-    switch (hresult) {
-      case SIMCONNECT_EXCEPTION_ALREADY_CREATED:
-        LOG_ERROR("Client data area BIG_CLIENT_DATA_NAME already in use: " + BIG_CLIENT_DATA_NAME);
-        break;
-      case SIMCONNECT_EXCEPTION_DUPLICATE_ID:
-        LOG_ERROR("Client data area ID already in use: " + std::to_string(BIG_CLIENT_DATA_ID));
-        break;
-      default:
-        LOG_ERROR("Mapping client data area BIG_CLIENT_DATA_NAME to ID failed: " + BIG_CLIENT_DATA_NAME);
-    }
+/**
+ * Called by the stream demultiplexer when a received stream is complete - its buffer is reused afterwards.
+ */
+void onStreamSenderComplete(uint32_t streamId, const StreamReassembler& stream) {
+  const auto& metaData = stream.metaData();
+  streamReassemblyTime.record(std::chrono::steady_clock::now() - stream.startTime());
+  TRACE_COMPLETE("receive stream", "stream", stream.startTime());
+  // restore compressed data before verification - size and hash refer to the original data
+  if (metaData.compression == StreamCompression::NONE) {
+    verifyStreamSenderData(streamId, stream, stream.data());
+    return;
   }
-
-  // Add the data definition to the client data area
-  if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, BIG_CLIENT_DATA_DEFINITION_ID, SIMCONNECT_CLIENTDATAOFFSET_AUTO,
-                                                      sizeof(bigClientData)))) {
-    LOG_ERROR("Adding to client data definition failed: " + BIG_CLIENT_DATA_NAME);
+  const auto& wireData = stream.data();
+  auto streamSenderData = streamBufferPool.acquire(metaData.size);
+  if (!decompress(wireData.data(), wireData.size(), streamSenderData.data(), streamSenderData.size(), metaData.compression)) {
+    traceLog->record(TraceEvent::STREAM_DECOMPRESS_FAILED, streamId, 0, wireData.size());
+    LOGM_ERROR(streamLog(), "Decompressing {} stream {} failed", STREAM_SENDER_DATA_NAME, streamId);
+    std::cout << "STREAM SENDER DATA: "
+              << " stream = " << streamId << " compressed size = " << wireData.size() << " (decompression failed, match = false)"
+              << std::endl;
+    traceLog->record(TraceEvent::STREAM_RECEIVE_COMPLETED, streamId, 0, metaData.size, 0);
+    streamBufferPool.release(std::move(streamSenderData));
+    return;
   }
+  std::cout << "Decompressed " << wireData.size() << " bytes to " << streamSenderData.size() << " bytes" << std::endl;
+  verifyStreamSenderData(streamId, stream, streamSenderData);
+  streamBufferPool.release(std::move(streamSenderData));
+}
 
-  // Create/allocate the client data area
-  if (!SUCCEEDED(SimConnect_CreateClientData(hSimConnect, BIG_CLIENT_DATA_ID, sizeof(bigClientData),
-                                             SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT))) {
-    LOG_ERROR("Creating client data failed: " + BIG_CLIENT_DATA_NAME);
+void processStreamData(const StreamChunk& chunk) {
+  TRACE_SPAN("receive chunk", "stream");
+  streamReceivedChunks.add();
+  streamReceivedBytes.add(sizeof(chunk));
+  // the demultiplexer calls onStreamSenderProgress() and onStreamSenderComplete()
+  if (!streamSenderStreams.onChunk(chunk.data)) {
+    LOGM_WARN_RATE(streamLog(), 1, "Received chunk of an unknown stream: {}", STREAM_SENDER_DATA_NAME);
   }
+}
 
-  // =========================
-  // STREAM RECEIVER META DATA
-
-  hresult = SimConnect_MapClientDataNameToID(hSimConnect, STREAM_RECEIVER_META_DATA_NAME.c_str(), STREAM_RECEIVER_META_DATA_ID);
-  if (hresult != S_OK) {
-    switch (hresult) {
-      case SIMCONNECT_EXCEPTION_ALREADY_CREATED:
-        LOG_ERROR("Client data area STREAM_RECEIVER_META_DATA_NAME already in use: " + STREAM_RECEIVER_META_DATA_NAME);
-        break;
-      case SIMCONNECT_EXCEPTION_DUPLICATE_ID:
-        LOG_ERROR("Client data area ID already in use: " + std::to_string(STREAM_RECEIVER_META_DATA_ID));
-        break;
-      default:
-        LOG_ERROR("Mapping client data area STREAM_RECEIVER_META_DATA_NAME to ID failed: " + STREAM_RECEIVER_META_DATA_NAME);
+void processStreamMetaData(const StreamMetaData& metaData) {
+  LOGM_INFO(streamLog(), "Received client data: {} stream {}", STREAM_SENDER_META_DATA_NAME, metaData.streamId);
+  const uint64_t invalidStreams = streamSenderStreams.stats().invalid;
+  if (!streamSenderStreams.start(metaData)) {
+    // invalid meta data is logged by the reassembler
+    if (streamSenderStreams.stats().invalid == invalidStreams) {
+      LOGM_WARN(streamLog(), "Too many concurrent streams - ignoring stream {}", metaData.streamId);
     }
+    return;
   }
+  traceLog->record(TraceEvent::STREAM_RECEIVE_STARTED, metaData.streamId, 0, streamWireSize(metaData),
+                   metaData.stripeCount);
+  std::cout << "STREAM SENDER DATA ---- ( received from sim ) -----------------------------" << std::endl;
+  std::cout << "Stream Sender stream id: " << metaData.streamId << std::endl;
+  std::cout << "Stream Sender size     : " << metaData.size << std::endl;
+  std::cout << "Stream Sender Data hash: " << metaData.hash << std::endl;
+  std::cout << "Stream Sender Data algo: " << static_cast<uint32_t>(metaData.algorithm) << std::endl;
+  std::cout << "Stream Sender chunk hashes: " << metaData.chunkHashCount << std::endl;
+  std::cout << "Stream Sender stripes  : " << metaData.stripeCount << std::endl;
+  std::cout << "Stream Sender compressed size: " << metaData.compressedSize << " (compression " << static_cast<uint32_t>(metaData.compression)
+            << ")" << std::endl;
+}
 
-  // Add the data definition to the client data area
-  if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, STREAM_RECEIVER_META_DATA_DEFINITION_ID,
-                                                      SIMCONNECT_CLIENTDATAOFFSET_AUTO, streamReceiverMetaDataSize))) {
-    LOG_ERROR("Adding to client data definition failed: " + STREAM_RECEIVER_META_DATA_NAME);
-  }
+void processReceivedTitle(const SIMCONNECT_RECV* pRecv, [[maybe_unused]] DWORD cbData) {
+  LOG_INFO("Received sim object data: Title");
+  title = *((Title*)&static_cast<const SIMCONNECT_RECV_SIMOBJECT_DATA*>(pRecv)->dwData);
+}
 
-  // Create/allocate the client data area
-  if (!SUCCEEDED(SimConnect_CreateClientData(hSimConnect, STREAM_RECEIVER_META_DATA_ID, streamReceiverMetaDataSize,
-                                             SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT))) {
-    LOG_ERROR("Creating client data failed: " + STREAM_RECEIVER_META_DATA_NAME);
-  }
+void processException(const SIMCONNECT_RECV* pRecv, [[maybe_unused]] DWORD cbData) {
+  const auto* const pException = static_cast<const SIMCONNECT_RECV_EXCEPTION*>(pRecv);
+  LOGF_ERROR_RATE(5, "Exception in SimConnect connection: {} send_id:{} index:{}",
+                  SimconnectExceptionStrings::getSimConnectExceptionString(static_cast<SIMCONNECT_EXCEPTION>(pException->dwException)),
+                  pException->dwSendID, pException->dwIndex);
+}
 
-  // =========================
-  // STREAM RECEIVER DATA
-
-  hresult = SimConnect_MapClientDataNameToID(hSimConnect, STREAM_RECEIVER_DATA_NAME.c_str(), STREAM_RECEIVER_DATA_ID);
-  if (hresult != S_OK) {
-    switch (hresult) {
-      case SIMCONNECT_EXCEPTION_ALREADY_CREATED:
-        LOG_ERROR("Client data area STREAM_RECEIVER_DATA_NAME already in use: " + STREAM_RECEIVER_DATA_NAME);
-        break;
-      case SIMCONNECT_EXCEPTION_DUPLICATE_ID:
-        LOG_ERROR("Client data area ID already in use: " + std::to_string(STREAM_RECEIVER_DATA_ID));
-        break;
-      default:
-        LOG_ERROR("Mapping client data area STREAM_RECEIVER_DATA_NAME to ID failed: " + STREAM_RECEIVER_DATA_NAME);
+void processSystemState(const SIMCONNECT_RECV* pRecv, [[maybe_unused]] DWORD cbData) {
+  const auto* const pState = static_cast<const SIMCONNECT_RECV_SYSTEM_STATE*>(pRecv);
+  LOGF_INFO("SIMCONNECT_RECV_ID_SYSTEM_STATE: {} {} {} {}", pState->dwInteger, pState->szString, pState->dwRequestID, pState->fFloat);
+}
+
+/**
+ * Registers the handlers of all SimConnect messages we process. Client data areas receiving data get
+ * a handler keyed by their request ID - areas created later can be added with dispatcher.onRequest().
+ */
+void registerDispatchHandlers() {
+  dispatcher.on(SIMCONNECT_RECV_ID_OPEN, "OPEN", [](const SIMCONNECT_RECV*, DWORD) {
+    LOG_INFO("SimConnect connection opened");
+    initialize();
+  });
+  dispatcher.on(SIMCONNECT_RECV_ID_QUIT, "QUIT", [](const SIMCONNECT_RECV*, DWORD) { quit = 1; });
+  dispatcher.on(SIMCONNECT_RECV_ID_EXCEPTION, "EXCEPTION", processException);
+  dispatcher.on(SIMCONNECT_RECV_ID_SYSTEM_STATE, "SYSTEM_STATE", processSystemState);
+  dispatcher.on(SIMCONNECT_RECV_ID_EVENT_EX1, "EVENT_EX1", [](const SIMCONNECT_RECV*, DWORD) { LOG_INFO("SIMCONNECT_RECV_ID_EVENT_EX1"); });
+  dispatcher.onRequest(SIMCONNECT_RECV_ID_EVENT, EVENT_SIM_START, "EVENT_SIM_START",
+                       [](const SIMCONNECT_RECV*, DWORD) { LOG_INFO("EVENT_SIM_START"); });
+  dispatcher.onRequest(SIMCONNECT_RECV_ID_SIMOBJECT_DATA, TITLE_REQUEST_ID, "TITLE", processReceivedTitle);
+  streamSenderStreams.onProgress(onStreamSenderProgress);
+  streamSenderStreams.onComplete(onStreamSenderComplete);
+  streamSenderStreams.setSink(urgentStreamId, &streamSenderUrgentSink);
+  clientDataRegistry().forEach([](const ClientDataAreaBase& area) {
+    if (area.direction() == ClientDataDirection::SEND) {
+      return;
     }
-  }
+    dispatcher.onRequest(SIMCONNECT_RECV_ID_CLIENT_DATA, area.requestId(), area.name(), [&area](const SIMCONNECT_RECV* pRecv, DWORD cbData) {
+      area.deliver(static_cast<const SIMCONNECT_RECV_CLIENT_DATA*>(pRecv), cbData);
+    });
+  });
+}
 
-  // Add the data definition to the client data area
-  if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, STREAM_RECEIVER_DATA_DEFINITION_ID, SIMCONNECT_CLIENTDATAOFFSET_AUTO,
-                                                      ChunkSize))) {
-    LOG_ERROR("Adding to client data definition failed: " + STREAM_RECEIVER_DATA_NAME);
+void CALLBACK dispatchCallback(SIMCONNECT_RECV* pRecv, DWORD cbData, [[maybe_unused]] void* pContext) {
+  // messages without a handler are counted - see the dispatcher output - and sampled to the log
+  const bool withRequestId = pRecv->dwID == SIMCONNECT_RECV_ID_CLIENT_DATA || pRecv->dwID == SIMCONNECT_RECV_ID_SIMOBJECT_DATA;
+  traceLog->record(TraceEvent::MESSAGE_RECEIVED, withRequestId ? static_cast<const SIMCONNECT_RECV_SIMOBJECT_DATA*>(pRecv)->dwRequestID : 0, 0,
+                   cbData, pRecv->dwID);
+  dispatchedMessages.add();
+  dispatchedBytes.add(cbData);
+  if (!dispatcher.dispatch(pRecv, cbData)) {
+    LOGF_WARN_RATE(1, "Unhandled SimConnect message received: {}", pRecv->dwID);
   }
+}
 
-  // Create/allocate the client data area
-  if (!SUCCEEDED(
-          SimConnect_CreateClientData(hSimConnect, STREAM_RECEIVER_DATA_ID, ChunkSize, SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT))) {
-    LOG_ERROR("Creating client data failed: " + STREAM_RECEIVER_DATA_NAME);
+// messages pulled by the receive thread - produced by receiveLoop(), consumed by getDispatch()
+SpscRing receiveRing{receiveRingSize};
+std::atomic<bool> receiveThreadStop{false};
+std::atomic<uint64_t> receiveOversizedMessages{0};  // messages larger than the ring's maximum message size - dropped
+
+/**
+ * Receive thread - only copies SimConnect messages into the receive ring so slow handlers do not
+ * delay draining SimConnect. When the ring is full it waits for the main thread to catch up.
+ */
+void receiveLoop() {
+  TRACE_THREAD_NAME("receive");
+  while (!receiveThreadStop.load(std::memory_order_relaxed)) {
+    WaitForSingleObject(hSimConnectEvent, maxWaitMs);
+    SIMCONNECT_RECV* ptrData;
+    DWORD cbData;
+    bool received = false;
+    {
+      TRACE_SPAN("receive", "dispatch");
+      while (SUCCEEDED(SimConnect_GetNextDispatch(hSimConnect, &ptrData, &cbData))) {
+        if (cbData > receiveRing.maxMessageSize()) {
+          receiveOversizedMessages.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        // ptrData stays valid until the next GetNextDispatch - retry until the main thread made room
+        while (!receiveRing.tryPush(ptrData, cbData)) {
+          SetEvent(hReceivedEvent);
+          std::this_thread::yield();
+          if (receiveThreadStop.load(std::memory_order_relaxed)) {
+            return;
+          }
+        }
+        received = true;
+      }
+    }
+    if (received) {
+      SetEvent(hReceivedEvent);
+    }
   }
+}
 
-  // =========================
-  // STREAM SENDER META DATA
-
-  // Map the client data area EXAMPLE2_CLIENT_DATA_NAME to the client data area ID
-  hresult = SimConnect_MapClientDataNameToID(hSimConnect, STREAM_SENDER_META_DATA_NAME.c_str(), STREAM_SENDER_META_DATA_ID);
-  if (hresult != S_OK) {
-    switch (hresult) {
-      case SIMCONNECT_EXCEPTION_ALREADY_CREATED:
-        LOG_ERROR("Client data area STREAM_SENDER_META_DATA_NAME already in use: " + STREAM_SENDER_META_DATA_NAME);
-        break;
-      case SIMCONNECT_EXCEPTION_DUPLICATE_ID:
-        LOG_ERROR("Client data area ID already in use: " + std::to_string(STREAM_SENDER_META_DATA_ID));
-        break;
-      default:
-        LOG_ERROR("Mapping client data area STREAM_SENDER_META_DATA_NAME to ID failed: " + STREAM_SENDER_META_DATA_NAME);
+void getDispatch() {
+  TRACE_SPAN("getDispatch", "dispatch");
+  if (receiveThreadMode) {
+    // messages are processed in place in the ring and released afterwards
+    const char* data;
+    uint32_t size;
+    while (receiveRing.peek(data, size)) {
+      trafficCapture->recordReceived(reinterpret_cast<const SIMCONNECT_RECV*>(data), size);
+      dispatchCallback(reinterpret_cast<SIMCONNECT_RECV*>(const_cast<char*>(data)), size, nullptr);
+      receiveRing.pop();
     }
+    return;
   }
-  // Add the data definition to the client data area
-  if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, STREAM_SENDER_META_DATA_DEFINITION_ID, SIMCONNECT_CLIENTDATAOFFSET_AUTO,
-                                                      streamSenderMetaDataSize))) {
-    LOG_ERROR("Adding to client data definition failed: " + STREAM_SENDER_META_DATA_NAME);
+  SIMCONNECT_RECV* ptrData;
+  DWORD cbData;
+  while (SUCCEEDED(SimConnect_GetNextDispatch(hSimConnect, &ptrData, &cbData))) {
+    trafficCapture->recordReceived(ptrData, cbData);
+    dispatchCallback(ptrData, cbData, nullptr);
+  }
+}
+
+/**
+ * Sends one chunk of an outgoing stream to its STREAM RECEIVER DATA stripe. Chunks of multiplexed,
+ * acknowledged and striped streams get a StreamChunkHeader, the last chunk is padded to ChunkSize.
+ * @return true as the chunk is queued - sending errors are handled by the send queue
+ */
+bool sendStreamReceiverChunk(const OutgoingStream& stream, uint32_t sequence) {
+  TRACE_SPAN("send chunk", "stream");
+  const auto [data, size] = stream.chunk(sequence);
+  if (stream.source != nullptr && sequence >= stream.hashChunkCount) {
+    stream.source->advance(static_cast<size_t>(data - stream.wireData.data()));
   }
-  // Request the client data area when changed
-  if (!SUCCEEDED(SimConnect_RequestClientData(hSimConnect, STREAM_SENDER_META_DATA_ID, STREAM_SENDER_META_DATA_REQUEST_ID,
-                                              STREAM_SENDER_META_DATA_DEFINITION_ID, SIMCONNECT_CLIENT_DATA_PERIOD_ON_SET))) {
-    LOG_ERROR("ClientDataAreaVariable: Requesting client data failed: " + STREAM_SENDER_META_DATA_NAME);
+  const bool withHeader = hasChunkHeader(stream.metaData);
+  // full chunks without header are sent straight from the stream data
+  const auto* pChunk = reinterpret_cast<const StreamChunk*>(data);
+  StreamChunk buffer{};
+  if (withHeader || size < ChunkSize) {
+    // std::cout << "Sending chunk: " << std::setw(2) << sequence << " Size: " << size << std::endl;
+    const StreamChunkHeader header{sequence, stream.id};
+    const size_t headerSize = withHeader ? sizeof(StreamChunkHeader) : 0;
+    memcpy(buffer.data, &header, headerSize);
+    memcpy(buffer.data + headerSize, data, size);
+    pChunk = &buffer;
   }
+  // every chunk carries different data - chunks to the same stripe must not replace each other
+  const auto& stripe = *streamReceiverDataAreas[sequence % streamStripeCount];
+  stripe.set(sendQueue, *pChunk, SendMode::ORDERED);
+  traceLog->record(TraceEvent::STREAM_CHUNK_QUEUED, stream.id, sequence, static_cast<uint32_t>(size), stripe.id());
+  streamSentChunks.add();
+  streamSentBytes.add(sizeof(StreamChunk));
+  return true;
+}
 
-  // =========================
-  // STREAM SENDER DATA
-
-  // Map the client data area EXAMPLE2_CLIENT_DATA_NAME to the client data area ID
-  hresult = SimConnect_MapClientDataNameToID(hSimConnect, STREAM_SENDER_DATA_NAME.c_str(), STREAM_SENDER_DATA_ID);
-  if (hresult != S_OK) {
-    switch (hresult) {
-      case SIMCONNECT_EXCEPTION_ALREADY_CREATED:
-        LOG_ERROR("Client data area already in use: " + STREAM_SENDER_DATA_NAME);
-        break;
-      case SIMCONNECT_EXCEPTION_DUPLICATE_ID:
-        LOG_ERROR("Client data area ID already in use: " + std::to_string(STREAM_SENDER_DATA_ID));
-        break;
-      default:
-        LOG_ERROR("Mapping client data area " + STREAM_SENDER_DATA_NAME + " to ID + " + std::to_string(STREAM_SENDER_DATA_ID) + " failed");
-    }
+/**
+ * Queues the next chunks of an outgoing stream - with ack window as far as the window allows,
+ * without as long as the send queue holds fewer than streamMaxQueuedWrites writes.
+ */
+void pumpStreamReceiverStream(OutgoingStream& stream) {
+  if (stream.window.isActive()) {
+    // without any ack the meta data may have been lost - the receiver would drop every chunk of the stream
+    stream.window.pump([&stream](uint32_t sequence) { return sendStreamReceiverChunk(stream, sequence); },
+                       [&stream] { streamReceiverMetaDataArea.set(sendQueue, stream.metaData, SendMode::MERGE, stream.id); });
+    return;
   }
-  // Add the data definition to the client data area
-  if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, STREAM_SENDER_DATA_DEFINITION_ID, SIMCONNECT_CLIENTDATAOFFSET_AUTO,
-                                                      ChunkSize))) {
-    LOG_ERROR("Adding to client data definition failed: " + STREAM_SENDER_DATA_NAME);
+  if (stream.nextChunk >= stream.chunkCount) {
+    return;
   }
-  if (!SUCCEEDED(SimConnect_RequestClientData(hSimConnect, STREAM_SENDER_DATA_ID, STREAM_SENDER_DATA_REQUEST_ID,
-                                              STREAM_SENDER_DATA_DEFINITION_ID, SIMCONNECT_CLIENT_DATA_PERIOD_ON_SET))) {
-    LOG_ERROR("ClientDataAreaVariable: Requesting client data failed: " + STREAM_SENDER_DATA_NAME);
+  while (stream.nextChunk < stream.chunkCount && sendQueue.depth() < streamMaxQueuedWrites) {
+    sendStreamReceiverChunk(stream, stream.nextChunk++);
   }
+  if (stream.nextChunk == stream.chunkCount) {
+    std::cout << "STREAM RECEIVER DATA  ---- ( sent to sim ) -----------------------------------" << std::endl;
+    std::cout << "Stream " << stream.id << " sent " << stream.chunkCount << " chunks" << " Sent bytes: " << streamWireSize(stream.metaData)
+              << std::endl;
+    traceLog->record(TraceEvent::STREAM_SEND_COMPLETED, stream.id, 0, streamWireSize(stream.metaData),
+                     stream.chunkCount);
+  }
+}
 
-  initilized = true;
-  LOG_INFO("SimConnect connection initialized");
+/**
+ * Starts a transfer of an outgoing stream - queues its meta data ahead of the chunks. The data must
+ * stay in place until the transfer is complete.
+ * @param wireData the data as sent - compressed if the meta data says so
+ * @param chunkHashes the chunk hashes sent ahead of the data - empty without tree fingerprint
+ */
+void startStreamReceiverStream(OutgoingStream& stream, std::span<const char> wireData, std::span<const char> chunkHashes) {
+  stream.metaData.streamId = stream.id;
+  stream.metaData.ackWindow = streamAckWindow;
+  stream.metaData.stripeCount = streamStripeCount;
+  // queued ahead of the chunks so the receiver is prepared when they arrive - the meta data of other streams must not replace it
+  streamReceiverMetaDataArea.set(sendQueue, stream.metaData, SendMode::MERGE, stream.id);
+  std::cout << "STREAM RECEIVER DATA  ---- ( sent to sim ) ------------------------------" << std::endl;
+  std::cout << "STREAM RECEIVER DATA stream: " << stream.id << " size: " << stream.metaData.size
+            << " STREAM RECEIVER DATA hash: " << stream.metaData.hash << std::endl;
+
+  stream.hashData = chunkHashes;
+  stream.wireData = wireData;
+  stream.payloadSize = streamReceiverPayloadSize(stream.id);
+  stream.hashChunkCount = static_cast<uint32_t>(chunkCount(chunkHashes.size(), stream.payloadSize));
+  stream.chunkCount = stream.hashChunkCount + static_cast<uint32_t>(chunkCount(wireData.size(), stream.payloadSize));
+  traceLog->record(TraceEvent::STREAM_SEND_STARTED, stream.id, 0, streamWireSize(stream.metaData),
+                   stream.chunkCount);
+
+  if (streamAckWindow > 0) {
+    // the chunks are sent by pumpStreamingClientData() as acks arrive
+    stream.nextChunk = stream.chunkCount;
+    stream.window.start(stream.chunkCount);
+    return;
+  }
+  stream.nextChunk = 0;
+  pumpStreamReceiverStream(stream);
 }
 
-void processStreamData(const SIMCONNECT_RECV_CLIENT_DATA* pClientData) {
-  std::size_t remainingBytes = expectedByteCount - receivedBytes;
-  if (remainingBytes > ChunkSize) {
-    remainingBytes = ChunkSize;
+void sendStreamingClientData() {
+  OutgoingStream& stream = streamReceiverLongStream;
+  if (stream.isSending()) {
+    LOGM_WARN(streamLog(), "Previous stream still in progress - not sending {}", STREAM_RECEIVER_DATA_NAME);
+    return;
   }
 
-  streamSenderData.insert(streamSenderData.end(), (char*)&pClientData->dwData, (char*)&pClientData->dwData + remainingBytes);
+  assert((streamReceiverDataSizeInBytes == streamReceiverDataSize) &&
+         "STREAM RECEIVER DATA size is not equal to STREAM RECEIVER DATA size in bytes");
 
-  receivedChunks++;
-  receivedBytes += remainingBytes;
-  //  std::cout << "Received data chunk " << receivedChunks << " of " << remainingBytes << " Byte received: " << STREAM_SENDER_DATA_NAME <<
-  //  " ("
-  //            << receivedBytes << "/" << expectedByteCount << ") " << std::endl;
+  const auto& chunkHashes = streamReceiverTreeFingerprint.chunkHashes;
+  stream.metaData.size = streamReceiverDataSizeInBytes;
+  stream.metaData.hash = streamTreeFingerprintMode ? streamReceiverTreeFingerprint.root : streamReceiverDataHash;
+  stream.metaData.algorithm = DefaultFingerprintAlgorithm;
+  stream.metaData.chunkHashCount = streamTreeFingerprintMode ? static_cast<uint32_t>(chunkHashes.size()) : 0;
+  const bool compressed = streamCompression != StreamCompression::NONE && streamReceiverCompressedData.size() < streamReceiverData.size();
+  stream.metaData.compression = compressed ? streamCompression : StreamCompression::NONE;
+  stream.metaData.compressedSize = compressed ? streamReceiverCompressedData.size() : 0;
+  const std::span<const char> hashData(reinterpret_cast<const char*>(chunkHashes.data()), chunkHashes.size() * sizeof(uint64_t));
+  startStreamReceiverStream(stream, compressed ? streamReceiverCompressedData : streamReceiverData,
+                            streamTreeFingerprintMode ? hashData : std::span<const char>{});
+}
 
-  const bool receivedAllData = receivedBytes >= expectedByteCount;
-  if (receivedAllData) {
-    std::cout << "Received all stream data: " << STREAM_SENDER_DATA_NAME << std::endl;
-    const uint64_t fingerPrintFvn = fingerPrintFVN(streamSenderData);
-    std::cout << "STREAM SENDER DATA: "
-              << " size = " << streamSenderData.size() << " bytes = " << receivedBytes << " chunks = " << receivedChunks
-              << " fingerprint = " << std::setw(21) << fingerPrintFvn << " (match = " << std::boolalpha
-              << (fingerPrintFvn == streamSenderMetaData.hash) << ")" << std::endl;
-    if (!streamSenderData.empty()) {
-      std::cout << "Content: "
-                << "[" << std::string(streamSenderData.begin(), streamSenderData.begin() + 100) << " ... ]" << std::endl;
-    }
+/**
+ * Sends the small urgent stream - it completes on its own while the long stream is still in progress.
+ */
+void sendUrgentStreamingClientData() {
+  OutgoingStream& stream = streamReceiverUrgentStream;
+  if (stream.isSending()) {
+    LOGM_WARN(streamLog(), "Previous urgent stream still in progress - not sending {}", STREAM_RECEIVER_DATA_NAME);
     return;
   }
+  stream.metaData.size = streamReceiverUrgentData.size();
+  stream.metaData.hash = fingerprint(streamReceiverUrgentData.data(), streamReceiverUrgentData.size(), DefaultFingerprintAlgorithm);
+  stream.metaData.algorithm = DefaultFingerprintAlgorithm;
+  stream.metaData.chunkHashCount = 0;
+  stream.metaData.compression = StreamCompression::NONE;
+  stream.metaData.compressedSize = 0;
+  startStreamReceiverStream(stream, streamReceiverUrgentData, {});
 }
 
-void processReceivedClientData(SIMCONNECT_RECV* pRecv) {
-  const auto pClientData = reinterpret_cast<const SIMCONNECT_RECV_CLIENT_DATA*>(pRecv);
-
-  switch (pClientData->dwRequestID) {
-    case EXAMPLE_CLIENT_DATA_REQUEST_ID:
-      LOG_INFO("Received client data: " + EXAMPLE_CLIENT_DATA_NAME);
-      std::memcpy(&exampleClientData, &pClientData->dwData, exampleClientDataSize);
-      break;
-    case EXAMPLE2_CLIENT_DATA_REQUEST_ID:
-      LOG_INFO("Received client data: " + EXAMPLE2_CLIENT_DATA_NAME);
-      std::memcpy(&example2ClientData, &pClientData->dwData, example2ClientDataSize);
-      break;
-    case STREAM_SENDER_META_DATA_REQUEST_ID:
-      LOG_INFO("Received client data: " + STREAM_SENDER_META_DATA_NAME);
-      std::memcpy(&streamSenderMetaData, &pClientData->dwData, sizeof(streamSenderMetaData));
-      streamSenderData.clear();
-      receivedBytes = 0;
-      receivedChunks = 0;
-      expectedByteCount = streamSenderMetaData.size;
-      streamSenderData.reserve(expectedByteCount);
-      std::cout << "STREAM SENDER DATA ---- ( received from sim ) -----------------------------" << std::endl;
-      std::cout << "Stream Sender size     : " << streamSenderMetaData.size << std::endl;
-      std::cout << "Stream Sender Data hash: " << streamSenderMetaData.hash << std::endl;
-      break;
-    case STREAM_SENDER_DATA_REQUEST_ID:
-      processStreamData(pClientData);
-      break;
-    default:
-      LOG_WARN("Received unknown client data request ID: " + std::to_string(pClientData->dwRequestID));
-      break;
-  }
-}
-
-void processReceivedSimObjectData(SIMCONNECT_RECV* pRecv) {
-  const auto pData = reinterpret_cast<const SIMCONNECT_RECV_SIMOBJECT_DATA*>(pRecv);
-  switch (pData->dwRequestID) {
-    case TITLE_REQUEST_ID:
-      LOG_INFO("Received sim object data: Title");
-      title = *((Title*)&pData->dwData);
-      break;
-    default:
-      LOG_WARN("Received unknown sim object data request ID: " + std::to_string(pData->dwRequestID));
-      break;
-  }
-}
-
-void CALLBACK dispatchCallback(SIMCONNECT_RECV* pRecv, [[maybe_unused]] DWORD cbData, [[maybe_unused]] void* pContext) {
-  switch (pRecv->dwID) {
-    case SIMCONNECT_RECV_ID_SIMOBJECT_DATA:
-      processReceivedSimObjectData(pRecv);
-      break;
-
-    case SIMCONNECT_RECV_ID_CLIENT_DATA:
-      processReceivedClientData(pRecv);
-      break;
-
-    case SIMCONNECT_RECV_ID_EVENT: {
-      auto* evt = (SIMCONNECT_RECV_EVENT*)pRecv;
-      switch (evt->uEventID) {
-        case EVENT_SIM_START:
-          LOG_INFO("EVENT_SIM_START");
-          break;
-        default:
-          break;
-      }
-      break;
-    }
-
-    case SIMCONNECT_RECV_ID_EVENT_EX1:
-      LOG_INFO("SIMCONNECT_RECV_ID_EVENT_EX1");
-      break;
-
-    case SIMCONNECT_RECV_ID_OPEN:
-      LOG_INFO("SimConnect connection opened");
-      initialize();
-      break;
-
-    case SIMCONNECT_RECV_ID_EXCEPTION: {
-      auto* const pException = reinterpret_cast<SIMCONNECT_RECV_EXCEPTION*>(pRecv);
-      LOG_ERROR("Exception in SimConnect connection: " +
-                SimconnectExceptionStrings::getSimConnectExceptionString(static_cast<SIMCONNECT_EXCEPTION>(pException->dwException)) +
-                " send_id:" + std::to_string(pException->dwSendID) + " index:" + std::to_string(pException->dwIndex));
-      break;
-    }
+/**
+ * Sends the file given with FBW_STREAM_FILE straight from its mapping.
+ */
+void sendFileStreamingClientData() {
+  OutgoingStream& stream = streamReceiverFileStream;
+  if (stream.isSending()) {
+    LOGM_WARN(streamLog(), "Previous file stream still in progress - not sending {}", STREAM_RECEIVER_DATA_NAME);
+    return;
+  }
+  const auto data = streamReceiverFileSource.data();
+  stream.metaData.size = data.size();
+  stream.metaData.hash = streamReceiverFileHash;
+  stream.metaData.algorithm = DefaultFingerprintAlgorithm;
+  stream.metaData.chunkHashCount = 0;
+  stream.metaData.compression = StreamCompression::NONE;
+  stream.metaData.compressedSize = 0;
+  startStreamReceiverStream(stream, data, {});
+}
 
-    case SIMCONNECT_RECV_ID_QUIT:
-      quit = 1;
-      break;
+/**
+ * Sends the next chunks of the outgoing streams - see pumpStreamReceiverStream().
+ */
+void pumpStreamingClientData() {
+  for (OutgoingStream* stream : streamReceiverStreams) {
+    pumpStreamReceiverStream(*stream);
+  }
+}
 
-    case SIMCONNECT_RECV_ID_SYSTEM_STATE: {
-      auto* const pState = reinterpret_cast<SIMCONNECT_RECV_SYSTEM_STATE*>(pRecv);
-      LOG_INFO("SIMCONNECT_RECV_ID_SYSTEM_STATE: " + std::to_string(pState->dwInteger) + " " + pState->szString + " " +
-               std::to_string(pState->dwRequestID) + " " + std::to_string(pState->fFloat));
-      break;
-    }
+/** @return true if chunks of a stream without ack window wait for room in the send queue */
+bool hasStreamReceiverChunksWaiting() {
+  return std::any_of(streamReceiverStreams.begin(), streamReceiverStreams.end(),
+                     [](const OutgoingStream* stream) { return stream->nextChunk < stream->chunkCount; });
+}
 
-    default:
-      LOG_WARN("Unknown/Unimplemented SimConnect message received: " + std::to_string(pRecv->dwID));
-      break;
+void processStreamReceiverAck(const StreamAck& ack) {
+  traceLog->record(TraceEvent::STREAM_ACK_RECEIVED, ack.streamId, ack.ackedChunks);
+  const auto it = std::find_if(streamReceiverStreams.begin(), streamReceiverStreams.end(),
+                               [&ack](const OutgoingStream* stream) { return stream->id == ack.streamId; });
+  if (it == streamReceiverStreams.end()) {
+    LOGM_WARN_RATE(streamLog(), 1, "Received ack of an unknown stream: {}", ack.streamId);
+    return;
+  }
+  OutgoingStream& stream = **it;
+  if (stream.window.onAck(ack.ackedChunks)) {
+    traceLog->record(TraceEvent::STREAM_SEND_COMPLETED, stream.id, 0, streamWireSize(stream.metaData),
+                     stream.window.chunkCount());
+    std::cout << "STREAM RECEIVER DATA  ---- ( sent to sim ) -----------------------------------" << std::endl;
+    std::cout << "Stream " << stream.id << " sent " << stream.window.chunkCount() << " chunks"
+              << " Sent bytes: " << streamWireSize(stream.metaData) << " window: " << stream.window.window()
+              << " retransmits: " << stream.window.retransmitCount() << " timeouts: " << stream.window.timeoutCount()
+              << " meta data resends: " << stream.window.startResendCount() << std::endl;
   }
 }
 
-void getDispatch() {
-  SIMCONNECT_RECV* ptrData;
-  DWORD cbData;
-  while (SUCCEEDED(SimConnect_GetNextDispatch(hSimConnect, &ptrData, &cbData))) {
-    dispatchCallback(ptrData, cbData, nullptr);
+void requestTitle() {
+  if (!SUCCEEDED(SimConnect_RequestDataOnSimObject(hSimConnect, TITLE_REQUEST_ID, TITLE_DEFINITION_ID, SIMCONNECT_OBJECT_ID_USER,
+                                                   SIMCONNECT_PERIOD_ONCE, SIMCONNECT_DATA_REQUEST_FLAG_DEFAULT))) {
+    LOG_ERROR("Requesting title failed");
+    quit = 1;
   }
 }
 
-void sendStreamingClientData() {
+void updateExampleClientData() {
   // =========================
-  // STREAM RECEIVER META DATA
-
-  streamReceiverMetaData.size = streamReceiverDataSizeInBytes;
-  streamReceiverMetaData.hash = streamReceiverDataHash;
-  if (!SUCCEEDED(SimConnect_SetClientData(hSimConnect, STREAM_RECEIVER_META_DATA_ID, STREAM_RECEIVER_META_DATA_DEFINITION_ID,
-                                          SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, streamReceiverMetaDataSize,
-                                          &streamReceiverMetaData))) {
-    LOG_ERROR("Setting data to sim for " + STREAM_RECEIVER_META_DATA_NAME +
-              " with dataDefId=" + std::to_string(STREAM_RECEIVER_META_DATA_DEFINITION_ID) + " failed!");
+  // EXAMPLE CLIENT DATA
+  if (!exampleClientDataArea.request(hSimConnect)) {
+    LOGF_ERROR("ClientDataAreaVariable: Requesting client data failed: {}", EXAMPLE_CLIENT_DATA_NAME);
+    quit = 1;
     return;
   }
-  std::cout << "STREAM RECEIVER DATA  ---- ( sent to sim ) ------------------------------" << std::endl;
-  std::cout << "STREAM RECEIVER DATA size: " << streamReceiverMetaData.size << " STREAM RECEIVER DATA hash: " << streamReceiverMetaData.hash
-            << std::endl;
 
   // =========================
-  // STREAM RECEIVER DATA
-  int chunkCount = 0;
-  size_t sentBytes = 0;
-
-  std::cout << "STREAM RECEIVER DATA size: " << streamReceiverDataSize << std::endl;
-
-  assert((streamReceiverDataSizeInBytes == streamReceiverDataSize) &&
-         "STREAM RECEIVER DATA size is not equal to STREAM RECEIVER DATA size in bytes");
+  // EXAMPLE 2 CLIENT DATA
 
-  while (sentBytes < streamReceiverDataSize) {
-    size_t remainingBytes = streamReceiverData.size() - sentBytes;
-    chunkCount++;
-    if (remainingBytes >= ChunkSize) {
-      // std::cout << "Sending chunk: " << std::setw(2) << ++chunkCount << " Sent bytes: " << sentBytes << " Remaining bytes: " <<
-      // remainingBytes << std::endl;
-
-      auto pDataSet = &streamReceiverData[sentBytes];
-      if (!SUCCEEDED(SimConnect_SetClientData(hSimConnect, STREAM_RECEIVER_DATA_ID, STREAM_RECEIVER_DATA_DEFINITION_ID,
-                                              SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, ChunkSize, pDataSet))) {
-        LOG_ERROR("Setting data to sim for " + STREAM_RECEIVER_DATA_NAME +
-                  " with dataDefId=" + std::to_string(STREAM_RECEIVER_DATA_DEFINITION_ID) + " failed!");
-        break;
-      }
-      sentBytes += ChunkSize;
-    } else {
-      std::array<char, ChunkSize> buffer{};
-      auto const pDataSet = &streamReceiverData[sentBytes];
-      memcpy(buffer.data(), pDataSet, remainingBytes);
-
-      if (!SUCCEEDED(SimConnect_SetClientData(hSimConnect, STREAM_RECEIVER_DATA_ID, STREAM_RECEIVER_DATA_DEFINITION_ID,
-                                              SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, ChunkSize, buffer.data()))) {
-        LOG_ERROR("Setting data to sim for " + STREAM_RECEIVER_DATA_NAME +
-                  " with dataDefId=" + std::to_string(STREAM_RECEIVER_DATA_DEFINITION_ID) + " failed!");
-        break;
-      }
-      sentBytes += remainingBytes;
-    }
+  // Change and write example 2 client data
+  auto& example2 = example2ClientData.modify();
+  example2.aFloat64 += 0.33;
+  example2.aFloat32 += 0.33;
+  example2.anInt64 += 2;
+  example2.anInt32 += 2;
+  example2.anInt16 += 2;
+  example2.anInt8 += 2;
+
+  // skipped if nothing changed since the last write
+  if (!example2ClientData.flush(hSimConnect, &sendQueue)) {
+    LOGF_ERROR("Setting data to sim for {} with dataDefId={} failed!", EXAMPLE2_CLIENT_DATA_NAME, example2ClientDataArea.definitionId());
+    quit = 1;
   }
-  std::cout << "STREAM RECEIVER DATA  ---- ( sent to sim ) -----------------------------------" << std::endl;
-  std::cout << "Sent " << chunkCount << " chunks" << " Sent bytes: " << sentBytes << std::endl;
 }
 
-void simconnectLoop() {
-  while (quit == 0) {
-    if (!initilized) {
-      getDispatch();
-      Sleep(500);
-      continue;
-    }
+void updateBigClientData() {
+  // only the pages changed since the last write are sent
+  if (!bigClientDataWriter.write(hSimConnect, &bigClientData, &sendQueue)) {
+    LOGF_ERROR("Setting data to sim for {} failed!", BIG_CLIENT_DATA_NAME);
+    quit = 1;
+  }
+}
 
-    loopCounter++;
-    if (loopCounter % loopThrottleValue == 0) {
-      std::cout << "loopCounter: " << loopCounter << std::endl;
+void printOutput() {
+  std::cout << "TITLE      " << title.title << std::endl;
+
+  std::cout << "DATA 1 ---- ( requested from sim ) --------------------------------" << std::endl;
+  std::cout << "FLOAT64    " << exampleClientData.aFloat64 << std::endl;
+  std::cout << "FLOAT32    " << exampleClientData.aFloat32 << std::endl;
+  std::cout << "INT64      " << exampleClientData.anInt64 << std::endl;
+  std::cout << "INT32      " << exampleClientData.anInt32 << std::endl;
+  std::cout << "INT16      " << exampleClientData.anInt16 << std::endl;
+  std::cout << "INT8       " << int(exampleClientData.anInt8) << std::endl;
+
+  std::cout << "DATA 2 ---- ( sent to sim ) ---------------------------------------" << std::endl;
+  std::cout << "INT8       " << int(example2ClientData.get().anInt8) << std::endl;
+  std::cout << "INT16      " << example2ClientData.get().anInt16 << std::endl;
+  std::cout << "INT32      " << example2ClientData.get().anInt32 << std::endl;
+  std::cout << "INT64      " << example2ClientData.get().anInt64 << std::endl;
+  std::cout << "FLOAT32    " << example2ClientData.get().aFloat32 << std::endl;
+  std::cout << "FLOAT64    " << example2ClientData.get().aFloat64 << std::endl;
+  std::cout << "Writes: " << example2ClientData.fullWriteCount() << " full " << example2ClientData.spanWriteCount()
+            << " span, avoided: " << example2ClientData.avoidedWriteCount() << " writes " << example2ClientData.avoidedByteCount() << " bytes"
+            << std::endl;
 
-      // Request title
-      if (!SUCCEEDED(SimConnect_RequestDataOnSimObject(hSimConnect, TITLE_REQUEST_ID, TITLE_DEFINITION_ID, SIMCONNECT_OBJECT_ID_USER,
-                                                       SIMCONNECT_PERIOD_ONCE, SIMCONNECT_DATA_REQUEST_FLAG_DEFAULT))) {
-        LOG_ERROR("Requesting title failed");
-        break;
-      }
+  std::cout << "BIG META DATA  ---- ( sent to sim ) ------------------------------" << std::endl;
+  std::cout << "Big client data size: " << sizeof(bigClientData) << std::endl;
+  std::cout << "Fingerprint: " << fingerprint(bigClientData.dataChunk) << std::endl;
+  std::cout << "Range writes: " << bigClientDataWriter.rangeWriteCount() << " bytes: " << bigClientDataWriter.writtenBytes()
+            << " unchanged: " << bigClientDataWriter.skippedWriteCount() << std::endl;
+
+  std::cout << "DISPATCHER ---- ( handlers by total time ) ------------------------" << std::endl;
+  for (const auto& handler : dispatcher.stats()) {
+    std::cout << std::left << std::setw(28) << handler.name << std::right << " calls: " << std::setw(8) << handler.calls
+              << " total: " << std::setw(10) << std::chrono::duration_cast<std::chrono::microseconds>(handler.total).count()
+              << " us max: " << std::setw(8) << std::chrono::duration_cast<std::chrono::microseconds>(handler.max).count() << " us"
+              << std::endl;
+  }
+  std::cout << "Unhandled messages: " << dispatcher.unhandledCount() << std::endl;
+
+  std::cout << "SCHEDULER ---- ( lateness of the jobs ) ---------------------------" << std::endl;
+  for (const auto& job : scheduler.stats()) {
+    const auto meanLateness = job.runs > 0 ? job.totalLateness / static_cast<int64_t>(job.runs) : Scheduler::Clock::duration::zero();
+    std::cout << std::left << std::setw(28) << job.name << std::right << " runs: " << std::setw(6) << job.runs
+              << " mean late: " << std::setw(6) << std::chrono::duration_cast<std::chrono::microseconds>(meanLateness).count()
+              << " us max late: " << std::setw(6) << std::chrono::duration_cast<std::chrono::microseconds>(job.maxLateness).count()
+              << " us overruns: " << job.overruns << std::endl;
+  }
+  std::cout << "Wake ups: " << wakeUps << std::endl;
+  const auto sendStats = sendQueue.stats();
+  const auto meanSendLatency = sendStats.sent > 0 ? sendStats.totalLatency / static_cast<int64_t>(sendStats.sent) : SendQueue::Clock::duration::zero();
+  std::cout << "Send queue: " << sendStats.sent << " writes " << sendStats.sentBytes << " bytes in " << sendStats.flushes << " flushes, merged "
+            << sendStats.merged << ", max depth " << sendStats.maxDepth << ", budget limited " << sendStats.budgetLimitedFlushes
+            << ", failed " << sendStats.failed << std::endl;
+  std::cout << "Send latency mean: " << std::chrono::duration_cast<std::chrono::microseconds>(meanSendLatency).count()
+            << " us max: " << std::chrono::duration_cast<std::chrono::microseconds>(sendStats.maxLatency).count()
+            << " us, flush time max: " << std::chrono::duration_cast<std::chrono::microseconds>(sendStats.maxFlushTime).count() << " us"
+            << std::endl;
+  if (asyncLogging) {
+    std::cout << "Dropped log messages: " << logger->droppedCount() << std::endl;
+  }
+  if (receiveThreadMode) {
+    std::cout << "Receive ring: " << receiveRing.pushedCount() << " messages, high water " << receiveRing.highWaterBytes() << " of "
+              << receiveRing.capacityBytes() << " bytes, full " << receiveRing.fullPushCount() << " times, oversized "
+              << receiveOversizedMessages.load(std::memory_order_relaxed) << std::endl;
+  }
+  if (trafficCapture->isOpen()) {
+    std::cout << "Traffic capture: " << trafficCapture->recordCount() << " records " << trafficCapture->byteCount() << " bytes"
+              << std::endl;
+  }
+  const auto& poolStats = streamBufferPool.stats();
+  std::cout << "Stream buffer pool: " << poolStats.hits << " hits " << poolStats.misses << " misses " << poolStats.discarded
+            << " discarded " << poolStats.unpooled << " unpooled, resident " << poolStats.residentBytes << " bytes, in use "
+            << poolStats.outstandingBytes << " bytes" << std::endl;
+  const auto& streamStats = streamSenderStreams.stats();
+  std::cout << "Received streams: " << streamStats.started << " started " << streamStats.completed << " completed " << streamStats.restarted
+            << " restarted " << streamStats.rejected << " rejected " << streamStats.invalid << " invalid, " << streamSenderStreams.activeCount()
+            << " in progress, orphan chunks " << streamStats.orphanChunks << std::endl;
+  if (streamReceiverFileSource.isOpen()) {
+    const auto& fileStream = streamReceiverFileStream;
+    const auto& fileSink = *streamSenderFileSink;
+    std::cout << "File stream: sent " << (streamAckWindow > 0 ? fileStream.window.ackedChunks() : fileStream.nextChunk) << " of "
+              << fileStream.chunkCount << " chunks, received " << fileSink.writtenBytes() << " of " << fileSink.size() << " bytes into "
+              << fileSink.path() << (fileSink.isComplete() ? " (complete)" : "") << std::endl;
+  }
+}
 
-      // =========================
-      // EXAMPLE CLIENT DATA
-      if (!SUCCEEDED(SimConnect_RequestClientData(hSimConnect, EXAMPLE_CLIENT_DATA_ID, EXAMPLE_CLIENT_DATA_REQUEST_ID,
-                                                  EXAMPLE_CLIENT_DATA_DEFINITION_ID, SIMCONNECT_CLIENT_DATA_PERIOD_ONCE))) {
-        LOG_ERROR("ClientDataAreaVariable: Requesting client data failed: " + EXAMPLE_CLIENT_DATA_NAME);
-        break;
-      }
+/**
+ * Copies the statistics kept by the components into metrics - runs before every metrics snapshot.
+ */
+void collectMetrics() {
+  const auto sendStats = sendQueue.stats();
+  metrics->counter("send.writes").set(sendStats.sent);
+  metrics->counter("send.bytes").set(sendStats.sentBytes);
+  metrics->counter("send.failed").set(sendStats.failed);
+  metrics->gauge("send.depth").set(static_cast<int64_t>(sendQueue.depth()));
+  clientDataRegistry().forEach([&sendStats](const ClientDataAreaBase& area) {
+    const auto it = sendStats.failedByArea.find(area.id());
+    if (it != sendStats.failedByArea.end()) {
+      metrics->counter("send.failed." + area.name()).set(it->second);
+    }
+  });
+  metrics->counter("dispatch.unhandled").set(dispatcher.unhandledCount());
+  if (receiveThreadMode) {
+    metrics->counter("receive.messages").set(receiveRing.pushedCount());
+    metrics->counter("receive.ring_full").set(receiveRing.fullPushCount());
+    metrics->counter("receive.oversized").set(receiveOversizedMessages.load(std::memory_order_relaxed));
+  }
+  metrics->counter("log.dropped").set(logger->droppedCount());
+  const auto& poolStats = streamBufferPool.stats();
+  metrics->counter("stream.buffer_pool.hits").set(poolStats.hits);
+  metrics->counter("stream.buffer_pool.misses").set(poolStats.misses);
+  metrics->counter("stream.buffer_pool.unpooled").set(poolStats.unpooled);
+  metrics->gauge("stream.buffer_pool.resident_bytes").set(static_cast<int64_t>(poolStats.residentBytes));
+  const auto& streamStats = streamSenderStreams.stats();
+  metrics->counter("stream.received_streams").set(streamStats.completed);
+  metrics->counter("stream.restarted_streams").set(streamStats.restarted);
+  metrics->counter("stream.rejected_streams").set(streamStats.rejected);
+  metrics->counter("stream.invalid_streams").set(streamStats.invalid);
+  metrics->counter("stream.orphan_chunks").set(streamStats.orphanChunks);
+  metrics->gauge("stream.active_streams").set(static_cast<int64_t>(streamSenderStreams.activeCount()));
+  if (streamSenderFileSink != nullptr) {
+    metrics->gauge("stream.file.received_bytes").set(static_cast<int64_t>(streamSenderFileSink->writtenBytes()));
+  }
+  metrics->counter("trace.records").set(traceLog->recordCount());
+}
 
-      // =========================
-      // EXAMPLE 2 CLIENT DATA
-
-      // Change and write example 2 client data
-      example2ClientData.aFloat64 += 0.33;
-      example2ClientData.aFloat32 += 0.33;
-      example2ClientData.anInt64 += 2;
-      example2ClientData.anInt32 += 2;
-      example2ClientData.anInt16 += 2;
-      example2ClientData.anInt8 += 2;
-
-      if (!SUCCEEDED(SimConnect_SetClientData(hSimConnect, EXAMPLE2_CLIENT_DATA_ID, EXAMPLE2_CLIENT_DATA_DEFINITION_ID,
-                                              SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, example2ClientDataSize, &example2ClientData))) {
-        LOG_ERROR("Setting data to sim for " + EXAMPLE2_CLIENT_DATA_NAME +
-                  " with dataDefId=" + std::to_string(EXAMPLE2_CLIENT_DATA_DEFINITION_ID) + " failed!");
-        break;
-      }
+void writeMetrics() {
+  if (metricsFile.is_open()) {
+    metrics->writeSnapshot(metricsFile);
+  }
+}
 
-      // =========================
-      // BIG CLIENT DATA
+#if CHROME_TRACE
+std::string chromeTraceFile{};
 
-      if (!SUCCEEDED(SimConnect_SetClientData(hSimConnect, BIG_CLIENT_DATA_ID, BIG_CLIENT_DATA_DEFINITION_ID,
-                                              SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, sizeof(bigClientData), &bigClientData))) {
-        LOG_ERROR("Setting data to sim for " + BIG_CLIENT_DATA_NAME + " with dataDefId=" + std::to_string(BIG_CLIENT_DATA_DEFINITION_ID) +
-                  " failed!");
-        break;
-      }
+void writeChromeTrace() {
+  if (!chromeTrace->isRecording()) {
+    return;
+  }
+  if (chromeTrace->write(chromeTraceFile)) {
+    LOGF_INFO("Chrome trace written to {}", chromeTraceFile);
+  } else {
+    LOGF_ERROR("Writing Chrome trace {} failed", chromeTraceFile);
+  }
+}
+#endif
+
+/**
+ * Adds the periodic jobs to the scheduler - called once the connection is initialized.
+ */
+void scheduleJobs() {
+  scheduler.every("TITLE REQUEST", titleRequestPeriod, requestTitle);
+  scheduler.every("EXAMPLE CLIENT DATA", exampleClientDataPeriod, updateExampleClientData);
+  scheduler.every("BIG CLIENT DATA", bigClientDataPeriod, updateBigClientData);
+  scheduler.every("STREAM SEND", streamSendPeriod, sendStreamingClientData);
+  scheduler.every("URGENT STREAM SEND", urgentStreamSendPeriod, sendUrgentStreamingClientData);
+  if (streamReceiverFileSource.isOpen()) {
+    scheduler.every("FILE STREAM SEND", fileStreamSendPeriod, sendFileStreamingClientData);
+  }
+  if (streamAckWindow > 0) {
+    // retransmits of an acknowledged stream are due even when no ack arrives to wake us up
+    scheduler.every("STREAM ACK TIMEOUT", streamAckTimeout / 2, pumpStreamingClientData);
+  }
+  // first output after the replies to the first requests have arrived
+  scheduler.every("OUTPUT", outputPeriod, printOutput, outputPeriod / 2);
+  scheduler.every("LOG SUPPRESSED", logSuppressedReportPeriod, [] { logger->reportSuppressed(); }, logSuppressedReportPeriod);
+  scheduler.every("METRICS", metricsPeriod, writeMetrics, metricsPeriod);
+  TRACE_BLOCK(scheduler.every("CHROME TRACE", chromeTraceDuration, writeChromeTrace, chromeTraceDuration));
+  if (trafficCapture->isOpen()) {
+    scheduler.every("CAPTURE FLUSH", trafficCaptureFlushPeriod, [] { trafficCapture->flush(); });
+  }
+}
 
-      sendStreamingClientData();
-    }
+void simconnectLoop() {
+  bool scheduled = false;
+  while (quit == 0) {
+    // sleep until SimConnect has messages for us or the next job is due - writes left over by the send budget and stream chunks
+    // waiting for room in the send queue go out right away
+    const bool sendPending = sendQueue.depth() > 0 || hasStreamReceiverChunksWaiting();
+    const DWORD timeout = sendPending ? 0 : scheduled ? scheduler.timeUntilNextMs(maxWaitMs) : maxWaitMs;
+    WaitForSingleObject(receiveThreadMode ? hReceivedEvent : hSimConnectEvent, timeout);
+    wakeUps++;
 
     // =========================
     // DISPATCH
     getDispatch();
+    pumpStreamingClientData();
+
+    if (!initilized) {
+      continue;
+    }
+    if (!scheduled) {
+      scheduleJobs();
+      scheduled = true;
+    }
+    scheduler.runDue();
 
     // =========================
-    // OUTPUT
-    if (loopCounter % loopThrottleValue == 0) {
-      std::cout << "TITLE      " << title.title << std::endl;
-
-      std::cout << "DATA 1 ---- ( requested from sim ) --------------------------------" << std::endl;
-      std::cout << "FLOAT64    " << exampleClientData.aFloat64 << std::endl;
-      std::cout << "FLOAT32    " << exampleClientData.aFloat32 << std::endl;
-      std::cout << "INT64      " << exampleClientData.anInt64 << std::endl;
-      std::cout << "INT32      " << exampleClientData.anInt32 << std::endl;
-      std::cout << "INT16      " << exampleClientData.anInt16 << std::endl;
-      std::cout << "INT8       " << int(exampleClientData.anInt8) << std::endl;
-
-      std::cout << "DATA 2 ---- ( sent to sim ) ---------------------------------------" << std::endl;
-      std::cout << "INT8       " << int(example2ClientData.anInt8) << std::endl;
-      std::cout << "INT16      " << example2ClientData.anInt16 << std::endl;
-      std::cout << "INT32      " << example2ClientData.anInt32 << std::endl;
-      std::cout << "INT64      " << example2ClientData.anInt64 << std::endl;
-      std::cout << "FLOAT32    " << example2ClientData.aFloat32 << std::endl;
-      std::cout << "FLOAT64    " << example2ClientData.aFloat64 << std::endl;
-
-      std::cout << "BIG META DATA  ---- ( sent to sim ) ------------------------------" << std::endl;
-      std::cout << "Big client data size: " << sizeof(bigClientData) << std::endl;
-      std::cout << "Fingerprint: " << fingerPrintFVN(std::vector(bigClientData.dataChunk.begin(), bigClientData.dataChunk.end()))
-                << std::endl;
+    // SEND
+    {
+      TRACE_SPAN("flush", "send");
+      sendQueue.flush(hSimConnect, sendBudgetBytesPerTick);
     }
   }
 }
@@ -649,32 +1078,191 @@ void prepareTestData() {
   std::cout << "Preparing test data for STREAM RECEIVER DATA..." << std::endl;
   std::cout << "STREAM RECEIVER DATA size: " << streamReceiverData.size() << std::endl;
   streamReceiverData.reserve(streamReceiverDataSizeInBytes);
-  streamReceiverData = std::vector<char>(longText.begin(), longText.end());
+  // build the stream data chunk by chunk and fingerprint each chunk as it is produced
+  Fingerprinter hasher(DefaultFingerprintAlgorithm);
+  for (size_t offset = 0; offset < longText.size(); offset += ChunkSize) {
+    const auto chunkBegin = longText.begin() + static_cast<std::ptrdiff_t>(offset);
+    const auto chunkEnd = longText.begin() + static_cast<std::ptrdiff_t>(std::min(offset + ChunkSize, longText.size()));
+    streamReceiverData.insert(streamReceiverData.end(), chunkBegin, chunkEnd);
+    hasher.update(&*chunkBegin, static_cast<size_t>(chunkEnd - chunkBegin));
+  }
   //  fillWithRandomCharData(streamReceiverData, streamReceiverDataSize);
-  streamReceiverDataHash = fingerPrintFVN(streamReceiverData);
+  streamReceiverDataHash = hasher.digest();
+  if (streamTreeFingerprintMode) {
+    // leaves of the size of the chunk payloads so a corrupt leaf is exactly one data chunk on the wire
+    streamReceiverTreeFingerprint = treeFingerprint(streamReceiverData.data(), streamReceiverData.size(), streamReceiverPayloadSize(longStreamId),
+                                                    DefaultFingerprintAlgorithm, &verificationPool());
+  }
   std::cout << "STREAM RECEIVER DATA size: " << streamReceiverData.size() * sizeof(char) << std::endl;
   std::cout << "STREAM RECEIVER DATA hash: " << streamReceiverDataHash << std::endl;
+  streamReceiverUrgentData.assign(longText.begin(), longText.begin() + static_cast<std::ptrdiff_t>(std::min(urgentStreamSize, longText.size())));
+  if (streamCompression != StreamCompression::NONE) {
+    streamReceiverCompressedData = compress(streamReceiverData.data(), streamReceiverData.size(), streamCompression);
+    std::cout << "STREAM RECEIVER DATA compressed size: " << streamReceiverCompressedData.size() << std::endl;
+  }
+}
+
+/**
+ * Maps the file to send as file stream and prepares the file it is received into.
+ */
+void prepareFileStream(const std::string& path) {
+  if (!streamReceiverFileSource.open(path)) {
+    std::cout << "Unable to open stream file " << path << std::endl;
+    return;
+  }
+  streamReceiverFileHash = streamReceiverFileSource.fingerprint(DefaultFingerprintAlgorithm);
+  streamReceiverFileStream.source = &streamReceiverFileSource;
+  streamSenderFileSink = std::make_unique<FileSink>(path + fileStreamReceivedSuffix, fileStreamFlushBytes);
+  streamSenderStreams.setSink(fileStreamId, streamSenderFileSink.get());
+  std::cout << "Stream file: " << path << " size: " << streamReceiverFileSource.data().size() << " hash: " << streamReceiverFileHash
+            << std::endl;
+}
+
+/**
+ * Feeds the received messages of a capture file through dispatchCallback() instead of connecting to
+ * SimConnect - a deterministic offline benchmark of the receive path. The messages are dispatched at
+ * their captured pace with recordedPacing, otherwise as fast as possible. Captured client data
+ * writes are skipped and writes queued by the handlers, e.g. stream acks, are not sent.
+ * @return exit code of the process
+ */
+int replayTraffic(const std::string& path, bool recordedPacing) {
+  TrafficReader reader;
+  if (!reader.open(path)) {
+    std::cout << "Unable to open capture file " << path << std::endl;
+    return 1;
+  }
+  std::cout << "Replaying " << path << " (" << reader.size() << " bytes) "
+            << (recordedPacing ? "at the recorded pace" : "as fast as possible") << std::endl;
+  // there is no connection - the captured OPEN message must not register the client data areas
+  initilized = true;
+
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  uint64_t skippedWrites = 0;
+  uint64_t firstTimestamp = 0;
+  const auto start = std::chrono::steady_clock::now();
+  TrafficReader::Record record{};
+  while (quit == 0 && reader.next(record)) {
+    if (record.header->direction != static_cast<uint16_t>(TrafficDirection::RECEIVED)) {
+      skippedWrites++;
+      continue;
+    }
+    if (recordedPacing) {
+      if (messages == 0) {
+        firstTimestamp = record.header->timestamp;
+      }
+      std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.header->timestamp - firstTimestamp));
+    }
+    dispatchCallback(reinterpret_cast<SIMCONNECT_RECV*>(const_cast<char*>(record.payload)), record.header->size, nullptr);
+    messages++;
+    bytes += record.header->size;
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+
+  printOutput();
+  std::cout << "REPLAY ---- ( " << path << " ) ------------------------------------" << std::endl;
+  if (reader.isTruncated()) {
+    std::cout << "Capture file ends within a record - replayed up to it" << std::endl;
+  }
+  std::cout << "Replayed " << messages << " messages " << bytes << " bytes in "
+            << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " us: "
+            << static_cast<uint64_t>(messages / seconds) << " messages/s " << static_cast<uint64_t>(bytes / seconds / (1024 * 1024))
+            << " MiB/s, skipped " << skippedWrites << " captured writes" << std::endl;
+  return 0;
 }
 
 int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[]) {
   using namespace std;
 
   cout << "FBW CPP Framework Testing" << endl;
+  // runtime log levels below the compile time LOG_LEVEL, e.g. "warn,stream=debug"
+  if (const char* logLevels = std::getenv("FBW_LOG_LEVELS"); logLevels != nullptr && !logger->setLevels(logLevels)) {
+    cout << "Invalid FBW_LOG_LEVELS: " << logLevels << endl;
+  }
+  if (const char* traceFile = std::getenv("FBW_TRACE_FILE");
+      traceFile != nullptr && *traceFile != '\0' && !traceLog->open(traceFile, traceRecords)) {
+    cout << "Unable to open trace file " << traceFile << endl;
+  }
+  if (const char* metricsFilePath = std::getenv("FBW_METRICS_FILE"); metricsFilePath != nullptr && *metricsFilePath != '\0') {
+    metricsFile.open(metricsFilePath, std::ios::app);
+    if (!metricsFile) {
+      cout << "Unable to open metrics file " << metricsFilePath << endl;
+    }
+    metrics->addCollector(collectMetrics);
+  }
+  if (const char* path = std::getenv("FBW_CAPTURE_FILE");
+      path != nullptr && *path != '\0' && !trafficCapture->open(path, trafficCaptureBufferBytes)) {
+    cout << "Unable to open capture file " << path << endl;
+  }
+#if CHROME_TRACE
+  if (const char* path = std::getenv("FBW_CHROME_TRACE"); path != nullptr && *path != '\0') {
+    chromeTraceFile = path;
+    chromeTrace->start(chromeTraceCapacity);
+    TRACE_THREAD_NAME("main");
+  }
+#endif
+  if (asyncLogging) {
+    logger->startAsync(asyncLogCapacity, LogOverflowPolicy::DROP);
+  }
   prepareTestData();
+  if (const char* path = std::getenv("FBW_STREAM_FILE"); path != nullptr && *path != '\0') {
+    prepareFileStream(path);
+  }
+  registerDispatchHandlers();
+
+  if (const char* path = std::getenv("FBW_REPLAY_FILE"); path != nullptr && *path != '\0') {
+    const char* pacing = std::getenv("FBW_REPLAY_PACING");
+    const int result = replayTraffic(path, pacing != nullptr && std::string(pacing) == "recorded");
+    TRACE_BLOCK(writeChromeTrace());
+    logger->reportSuppressed();
+    logger->stopAsync();
+    return result;
+  }
 
-  if (!SUCCEEDED(SimConnect_Open(&hSimConnect, "fbw-cpp-framework-test", nullptr, 0, nullptr, 0))) {
+#ifndef _WIN32
+  // Without a sim the loopback echoes what we send to the sim back to us
+  SimConnectLoopback::configure(SimConnectLoopback::Config::fromEnvironment());
+  SimConnectLoopback::mirrorClientData(EXAMPLE2_CLIENT_DATA_NAME, EXAMPLE_CLIENT_DATA_NAME);
+  SimConnectLoopback::mirrorClientData(STREAM_RECEIVER_META_DATA_NAME, STREAM_SENDER_META_DATA_NAME);
+  for (uint32_t stripe = 0; stripe < streamStripeCount; stripe++) {
+    SimConnectLoopback::mirrorClientData(streamStripeName(STREAM_RECEIVER_DATA_NAME, stripe), streamStripeName(STREAM_SENDER_DATA_NAME, stripe));
+  }
+  SimConnectLoopback::mirrorClientData(STREAM_SENDER_ACK_DATA_NAME, STREAM_RECEIVER_ACK_DATA_NAME);
+#endif
+
+  hSimConnectEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+  if (!SUCCEEDED(SimConnect_Open(&hSimConnect, "fbw-cpp-framework-test", nullptr, 0, hSimConnectEvent, 0))) {
     cout << "Unable to connect to Flight Simulator!" << endl;
     return 1;
   }
   cout << "Connected to Flight Simulator!" << endl;
 
+  std::thread receiveThread;
+  if (receiveThreadMode) {
+    hReceivedEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    receiveThread = std::thread(receiveLoop);
+  }
+
   simconnectLoop();
 
+  if (receiveThread.joinable()) {
+    receiveThreadStop = true;
+    SetEvent(hSimConnectEvent);
+    receiveThread.join();
+    CloseHandle(hReceivedEvent);
+  }
+
   if (!SUCCEEDED(SimConnect_Close(hSimConnect))) {
     cout << "Unable to disconnect from Flight Simulator!" << endl;
     return 1;
   }
   cout << "Disconnected from Flight Simulator!" << endl;
+  CloseHandle(hSimConnectEvent);
+  trafficCapture->close();
+  TRACE_BLOCK(writeChromeTrace());
+  logger->reportSuppressed();
+  logger->stopAsync();
 
   return 0;
 }
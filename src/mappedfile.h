@@ -0,0 +1,249 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_MAPPEDFILE_H
+#define FBW_CPP_FRAMEWORK_TEST_MAPPEDFILE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * A file mapped into memory as a whole - for streaming files larger than the available memory.
+ *
+ * The OS pages the file in on access and writes changes back on its own. prefetch() starts reading
+ * a range ahead of its use, flush() writes a range back and evict() drops a range from the process
+ * memory - it is read from the file again when accessed later. Reading ahead and evicting behind
+ * the position of a sequential pass keeps the memory use constant regardless of the file size.
+ *
+ * Empty files are opened without a mapping - data() is nullptr then.
+ *
+ * Usage:
+ *
+ * MappedFile file;
+ * if (file.openRead("data.bin")) { process(file.data(), file.size()); }
+ * if (file.create("copy.bin", size)) { write(file.data()); file.flush(0, size); }
+ */
+class MappedFile {
+ public:
+  MappedFile() = default;
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() { close(); }
+
+  /**
+   * Maps an existing file read only.
+   * @return false if the file could not be opened or mapped
+   */
+  bool openRead(const std::string& path) {
+    close();
+    return map(path, false, 0);
+  }
+
+  /**
+   * Creates or truncates a file of size bytes and maps it for writing. The file is sparse - only
+   * written ranges take up disk space.
+   * @return false if the file could not be created or mapped
+   */
+  bool create(const std::string& path, size_t size) {
+    close();
+    return map(path, true, size);
+  }
+
+  /** Unmaps and closes the file - changes not yet flushed are still written back by the OS. */
+  void close() {
+    unmap();
+    view = nullptr;
+    fileSize = 0;
+    opened = false;
+  }
+
+  [[nodiscard]] bool isOpen() const { return opened; }
+  [[nodiscard]] char* data() const { return view; }
+  [[nodiscard]] size_t size() const { return fileSize; }
+
+  /** Starts reading the range from the file in the background. */
+  void prefetch(size_t offset, size_t size) const {
+    const auto [begin, length] = pageRange(offset, size);
+    if (length == 0) {
+      return;
+    }
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range{view + begin, length};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    ::madvise(view + begin, length, MADV_WILLNEED);
+#endif
+  }
+
+  /** Writes the range back to the file and waits until it is written. */
+  void flush(size_t offset, size_t size) const {
+    const auto [begin, length] = pageRange(offset, size);
+    if (length == 0) {
+      return;
+    }
+#ifdef _WIN32
+    FlushViewOfFile(view + begin, length);
+    FlushFileBuffers(file);
+#else
+    ::msync(view + begin, length, MS_SYNC);
+#endif
+  }
+
+  /** Drops the pages of the range from the process memory - only whole pages inside the range. Flush written ranges first. */
+  void evict(size_t offset, size_t size) const {
+    const size_t page = pageSize();
+    const size_t begin = (offset + page - 1) / page * page;
+    const size_t end = std::min(offset + size, fileSize) / page * page;
+    if (view == nullptr || end <= begin) {
+      return;
+    }
+#ifdef _WIN32
+    // removes the pages from the working set - they stay in the file cache
+    VirtualUnlock(view + begin, end - begin);
+#else
+    ::madvise(view + begin, end - begin, MADV_DONTNEED);
+#endif
+  }
+
+  static size_t pageSize() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    static const auto size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+#endif
+  }
+
+ private:
+  char* view = nullptr;
+  size_t fileSize = 0;
+  bool opened = false;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+
+  /** @return the range extended to page boundaries and limited to the file */
+  [[nodiscard]] std::pair<size_t, size_t> pageRange(size_t offset, size_t size) const {
+    if (view == nullptr || offset >= fileSize) {
+      return {0, 0};
+    }
+    const size_t begin = offset / pageSize() * pageSize();
+    return {begin, std::min(offset + size, fileSize) - begin};
+  }
+
+#ifdef _WIN32
+  bool map(const std::string& path, bool writable, size_t size) {
+    file = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       writable ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    if (writable) {
+      DWORD returned;
+      DeviceIoControl(file, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned, nullptr);
+    } else {
+      LARGE_INTEGER length;
+      if (!GetFileSizeEx(file, &length)) {
+        unmap();
+        return false;
+      }
+      size = static_cast<size_t>(length.QuadPart);
+    }
+    fileSize = size;
+    opened = true;
+    if (size == 0) {
+      return true;
+    }
+    mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                 static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), nullptr);
+    view = mapping != nullptr ? static_cast<char*>(MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size)) : nullptr;
+    if (view == nullptr) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void unmap() {
+    if (view != nullptr) {
+      UnmapViewOfFile(view);
+    }
+    if (mapping != nullptr) {
+      CloseHandle(mapping);
+      mapping = nullptr;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+      CloseHandle(file);
+      file = INVALID_HANDLE_VALUE;
+    }
+  }
+#else
+  bool map(const std::string& path, bool writable, size_t size) {
+    fd = writable ? ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    if (writable) {
+      // extending with ftruncate leaves a hole - no disk space is allocated until written
+      if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close();
+        return false;
+      }
+    } else {
+      struct stat status {};
+      if (::fstat(fd, &status) != 0) {
+        close();
+        return false;
+      }
+      size = static_cast<size_t>(status.st_size);
+    }
+    fileSize = size;
+    opened = true;
+    if (size == 0) {
+      return true;
+    }
+    void* mapped = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+      close();
+      return false;
+    }
+    view = static_cast<char*>(mapped);
+    if (!writable) {
+      ::madvise(view, size, MADV_SEQUENTIAL);
+    }
+    return true;
+  }
+
+  void unmap() {
+    if (view != nullptr) {
+      ::munmap(view, fileSize);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+#endif
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_MAPPEDFILE_H
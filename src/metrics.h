@@ -0,0 +1,212 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_METRICS_H
+#define FBW_CPP_FRAMEWORK_TEST_METRICS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Registry of named counters, gauges and latency histograms.
+ *
+ * Metrics are created once by name and then updated through the returned reference with a relaxed
+ * atomic operation - no lock and no lookup on the hot path. The references stay valid for the
+ * lifetime of the registry. Statistics which are already kept elsewhere (e.g. by the send queue) are
+ * copied into metrics by collectors which run right before each snapshot.
+ *
+ * writeSnapshot() writes all metrics as one JSON line including the rate per second of every
+ * counter since the previous snapshot - appended to a file periodically this can be graphed directly.
+ * Metric names must not contain quotes or backslashes.
+ *
+ * Usage:
+ *
+ * auto& sentChunks = metrics->counter("stream.sent_chunks");  // once
+ * sentChunks.add();                                            // hot path
+ * metrics->histogram("stream.hash_time").record(elapsed);
+ * metrics->writeSnapshot(file);                                // periodically
+ */
+class MetricsRegistry {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /** Monotonic count - reported with its rate per second. */
+  class Counter {
+   public:
+    void add(uint64_t n = 1) { count.fetch_add(n, std::memory_order_relaxed); }
+    /** Sets the count - for counters mirrored from existing statistics by a collector. */
+    void set(uint64_t n) { count.store(n, std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t value() const { return count.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<uint64_t> count{0};
+  };
+
+  /** Current value of something - e.g. a queue depth. */
+  class Gauge {
+   public:
+    void set(int64_t v) { current.store(v, std::memory_order_relaxed); }
+    void add(int64_t n) { current.fetch_add(n, std::memory_order_relaxed); }
+    [[nodiscard]] int64_t value() const { return current.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<int64_t> current{0};
+  };
+
+  /**
+   * Latency histogram with fixed buckets from 1 us to 1 s in 1-2-5 steps and an overflow bucket.
+   * Percentiles are reported as the upper bound of the bucket they fall into.
+   */
+  class Histogram {
+   public:
+    static constexpr std::array<uint64_t, 19> BOUNDS_US = {1,    2,    5,     10,    20,    50,     100,    200,    500,    1000,
+                                                           2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000};
+
+    void record(Clock::duration elapsed) {
+      const auto us = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+      size_t bucket = 0;
+      while (bucket < BOUNDS_US.size() && us > BOUNDS_US[bucket]) {
+        bucket++;
+      }
+      buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+      totalUs.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t count() const {
+      uint64_t n = 0;
+      for (const auto& b : buckets) {
+        n += b.load(std::memory_order_relaxed);
+      }
+      return n;
+    }
+
+    [[nodiscard]] uint64_t sumUs() const { return totalUs.load(std::memory_order_relaxed); }
+
+    /** @return upper bound in us of the bucket holding the given fraction of the samples - 0 without samples, UINT64_MAX above 1 s */
+    [[nodiscard]] uint64_t percentileUs(double fraction) const {
+      const uint64_t n = count();
+      if (n == 0) {
+        return 0;
+      }
+      const auto rank = static_cast<uint64_t>(fraction * static_cast<double>(n - 1)) + 1;
+      uint64_t seen = 0;
+      for (size_t bucket = 0; bucket < BOUNDS_US.size(); bucket++) {
+        seen += buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+          return BOUNDS_US[bucket];
+        }
+      }
+      return UINT64_MAX;
+    }
+
+   private:
+    std::array<std::atomic<uint64_t>, BOUNDS_US.size() + 1> buckets{};
+    std::atomic<uint64_t> totalUs{0};
+  };
+
+  static MetricsRegistry* instance() {
+    static MetricsRegistry instance;
+    return &instance;
+  }
+
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  /** @return the counter with the given name - created on first use */
+  Counter& counter(const std::string& name) { return find(counters, name); }
+  /** @return the gauge with the given name - created on first use */
+  Gauge& gauge(const std::string& name) { return find(gauges, name); }
+  /** @return the histogram with the given name - created on first use */
+  Histogram& histogram(const std::string& name) { return find(histograms, name); }
+
+  /** Adds a function which updates metrics from other statistics - called at the start of every snapshot. */
+  void addCollector(std::function<void()> collector) {
+    std::lock_guard lock(mutex);
+    collectors.push_back(std::move(collector));
+  }
+
+  /** Runs the collectors and writes all metrics as one JSON line. */
+  void writeSnapshot(std::ostream& out) {
+    std::unique_lock lock(mutex);
+    // outside the lock so collectors can look up metrics
+    const auto currentCollectors = collectors;
+    lock.unlock();
+    for (const auto& collector : currentCollectors) {
+      collector();
+    }
+    lock.lock();
+    const auto now = Clock::now();
+    const double seconds = std::chrono::duration<double>(now - lastSnapshot).count();
+    lastSnapshot = now;
+
+    out << "{\"time_ms\":" << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+        << ",\"interval_s\":" << seconds << ",\"counters\":{";
+    const char* separator = "";
+    for (const auto& [name, index] : counters.byName) {
+      const uint64_t value = counters.metrics[index].value();
+      uint64_t& previous = counterSnapshots[name];
+      out << separator << "\"" << name << "\":{\"value\":" << value
+          << ",\"per_s\":" << (seconds > 0 ? static_cast<double>(value - previous) / seconds : 0.0) << "}";
+      previous = value;
+      separator = ",";
+    }
+    out << "},\"gauges\":{";
+    separator = "";
+    for (const auto& [name, index] : gauges.byName) {
+      out << separator << "\"" << name << "\":" << gauges.metrics[index].value();
+      separator = ",";
+    }
+    out << "},\"histograms\":{";
+    separator = "";
+    for (const auto& [name, index] : histograms.byName) {
+      const Histogram& h = histograms.metrics[index];
+      const uint64_t count = h.count();
+      out << separator << "\"" << name << "\":{\"count\":" << count << ",\"mean_us\":" << (count > 0 ? h.sumUs() / count : 0)
+          << ",\"p50_us\":" << h.percentileUs(0.5) << ",\"p90_us\":" << h.percentileUs(0.9) << ",\"p99_us\":" << h.percentileUs(0.99) << "}";
+      separator = ",";
+    }
+    out << "}}" << std::endl;
+  }
+
+ private:
+  MetricsRegistry() = default;
+
+  template <typename T>
+  struct Family {
+    std::deque<T> metrics;  // a deque keeps the metrics in place when growing
+    std::map<std::string, size_t> byName;
+  };
+
+  std::mutex mutex;
+  Family<Counter> counters;
+  Family<Gauge> gauges;
+  Family<Histogram> histograms;
+  std::vector<std::function<void()>> collectors;
+  std::map<std::string, uint64_t> counterSnapshots;
+  Clock::time_point lastSnapshot = Clock::now();
+
+  template <typename T>
+  T& find(Family<T>& family, const std::string& name) {
+    std::lock_guard lock(mutex);
+    const auto it = family.byName.find(name);
+    if (it != family.byName.end()) {
+      return family.metrics[it->second];
+    }
+    family.byName.emplace(name, family.metrics.size());
+    return family.metrics.emplace_back();
+  }
+};
+
+inline MetricsRegistry* metrics = MetricsRegistry::instance();
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_METRICS_H
@@ -0,0 +1,138 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_SCHEDULER_H
+#define FBW_CPP_FRAMEWORK_TEST_SCHEDULER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "logging.h"
+
+/**
+ * Runs periodic jobs on wall-clock timers.
+ *
+ * The scheduler does not wait itself - the main loop blocks on the SimConnect event handle with
+ * timeUntilNext() as timeout and calls runDue() after every wake up. Job times advance by their
+ * period from the previous due time so late runs do not accumulate drift. A job which is late by
+ * more than a whole period skips the missed runs and counts them as overruns.
+ *
+ * Every job records how late it was started compared to its due time (tick jitter).
+ *
+ * Usage:
+ *
+ * scheduler.every("TITLE", std::chrono::seconds(5), requestTitle);
+ * while (!quit) {
+ *   WaitForSingleObject(hEvent, scheduler.timeUntilNextMs(1000));
+ *   getDispatch();
+ *   scheduler.runDue();
+ * }
+ */
+class Scheduler {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Job = std::function<void()>;
+
+  /** Statistics of one job. */
+  struct JobStats {
+    std::string name;
+    Clock::duration period{};
+    uint64_t runs = 0;
+    uint64_t overruns = 0;
+    Clock::duration totalLateness{};
+    Clock::duration maxLateness{};
+    Clock::duration totalRunTime{};
+  };
+
+  /**
+   * Adds a job which runs every period - the first run is due at now + firstDelay.
+   * @return false if the period is not positive - the job is not added
+   */
+  bool every(std::string name, Clock::duration period, Job job, Clock::duration firstDelay = Clock::duration::zero()) {
+    if (period <= Clock::duration::zero()) {
+      LOGF_ERROR("Scheduler job {} rejected: period must be positive", name);
+      return false;
+    }
+    Entry entry{std::move(job), Clock::now() + firstDelay, {}};
+    entry.stats.name = std::move(name);
+    entry.stats.period = period;
+    jobs.push_back(std::move(entry));
+    return true;
+  }
+
+  /** @return time until the next job is due - zero if a job is already due, max() without jobs */
+  [[nodiscard]] Clock::duration timeUntilNext() const {
+    if (jobs.empty()) {
+      return Clock::duration::max();
+    }
+    const auto next = std::min_element(jobs.begin(), jobs.end(), [](const Entry& a, const Entry& b) { return a.due < b.due; })->due;
+    return std::max(next - Clock::now(), Clock::duration::zero());
+  }
+
+  /** @return timeUntilNext() in whole milliseconds rounded up for waits with millisecond timeouts, capped at maxWaitMs */
+  [[nodiscard]] uint32_t timeUntilNextMs(uint32_t maxWaitMs) const {
+    const auto wait = timeUntilNext();
+    if (wait >= std::chrono::milliseconds(maxWaitMs)) {
+      return maxWaitMs;
+    }
+    return static_cast<uint32_t>(std::chrono::ceil<std::chrono::milliseconds>(wait).count());
+  }
+
+  /**
+   * Runs all jobs which are due.
+   * @return number of jobs run
+   */
+  uint32_t runDue() {
+    uint32_t ran = 0;
+    // by index as jobs may add jobs - the deque keeps the running entry in place
+    for (size_t i = 0; i < jobs.size(); i++) {
+      const auto start = Clock::now();
+      if (jobs[i].due > start) {
+        continue;
+      }
+      const auto lateness = start - jobs[i].due;
+      auto& entry = jobs[i];
+      const Clock::duration period = entry.stats.period;
+      entry.job();
+      ran++;
+      entry.stats.runs++;
+      entry.stats.totalLateness += lateness;
+      entry.stats.maxLateness = std::max(entry.stats.maxLateness, lateness);
+      entry.stats.totalRunTime += Clock::now() - start;
+      entry.due += period;
+      if (entry.due <= start) {
+        // skip the runs missed while we were busy instead of running them back to back
+        const auto missed = (start - entry.due) / period + 1;
+        entry.stats.overruns += static_cast<uint64_t>(missed);
+        entry.due += missed * period;
+      }
+    }
+    return ran;
+  }
+
+  /** @return the statistics of all jobs in the order they were added */
+  [[nodiscard]] std::vector<JobStats> stats() const {
+    std::vector<JobStats> result;
+    result.reserve(jobs.size());
+    for (const auto& entry : jobs) {
+      result.push_back(entry.stats);
+    }
+    return result;
+  }
+
+ private:
+  struct Entry {
+    Job job;
+    Clock::time_point due;
+    JobStats stats;
+  };
+
+  std::deque<Entry> jobs;
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_SCHEDULER_H
@@ -0,0 +1,265 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_SENDQUEUE_H
+#define FBW_CPP_FRAMEWORK_TEST_SENDQUEUE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SimConnect.h"
+#include "logging.h"
+#include "tracelog.h"
+#include "trafficcapture.h"
+
+/**
+ * How a queued write relates to earlier writes of the same area and definition.
+ */
+enum class SendMode {
+  /** replaces a pending write of the same area, definition and merge key - only the latest content is sent */
+  MERGE,
+  /** always sent in order - e.g. stream chunks where every write carries different data */
+  ORDERED,
+};
+
+/**
+ * Collects client data writes and sends them in one burst per tick.
+ *
+ * Writes can be queued from any thread. A MERGE write replaces a pending write of the same area,
+ * definition and merge key (last writer wins) and keeps its place in the queue. The merge key keeps
+ * writes apart which share an area but must not replace each other - e.g. the acks of different
+ * streams. flush() sends the pending writes in order until the per-tick byte budget is used up - the
+ * rest is sent with the next flush. At least one write is sent per flush so writes larger than the
+ * budget still make progress.
+ *
+ * Failed writes are logged and dropped here. Owners which track what the sim has - e.g. to skip
+ * unchanged data - register a failure handler for their area with onFailed() and write everything
+ * again. flush() must always be called from the same thread.
+ *
+ * Usage:
+ *
+ * sendQueue.set(areaId, definitionId, &data, sizeof(data));  // anywhere during the tick
+ * sendQueue.flush(hSimConnect, 256 * 1024);                  // once per tick
+ */
+class SendQueue {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /** Counters of the queue. */
+  struct Stats {
+    uint64_t queued = 0;
+    uint64_t merged = 0;
+    uint64_t sent = 0;
+    uint64_t sentBytes = 0;
+    uint64_t failed = 0;
+    std::map<SIMCONNECT_CLIENT_DATA_ID, uint64_t> failedByArea;
+    uint64_t flushes = 0;
+    /** flushes which stopped at the byte budget with writes left over */
+    uint64_t budgetLimitedFlushes = 0;
+    size_t maxDepth = 0;
+    /** time from queueing to sending of the sent writes - for merged writes from the first queueing */
+    Clock::duration totalLatency{};
+    Clock::duration maxLatency{};
+    /** time spent in the SimConnect calls of a flush */
+    Clock::duration totalFlushTime{};
+    Clock::duration maxFlushTime{};
+  };
+
+  /**
+   * Sets the handler called by flush() when a write to the area failed - once per failed write.
+   * Must not be called while flush() runs.
+   */
+  void onFailed(SIMCONNECT_CLIENT_DATA_ID areaId, std::function<void()> handler) { failureHandlers[areaId] = std::move(handler); }
+
+  /**
+   * Queues a write of size bytes to the client data area using the given definition.
+   * The data is copied.
+   */
+  void set(SIMCONNECT_CLIENT_DATA_ID areaId,
+           SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId,
+           const void* data,
+           DWORD size,
+           SendMode mode = SendMode::MERGE,
+           uint32_t mergeKey = 0) {
+    std::lock_guard lock(mutex);
+    counters.queued++;
+    const WriteKey writeKey{areaId, definitionId, mergeKey};
+    if (mode == SendMode::MERGE) {
+      const auto it = mergeable.find(writeKey);
+      if (it != mergeable.end()) {
+        Write& pending = writes[it->second - firstSequence];
+        pendingBytes = pendingBytes - pending.data.size() + size;
+        pending.data.assign(static_cast<const char*>(data), static_cast<const char*>(data) + size);
+        counters.merged++;
+        return;
+      }
+    } else {
+      // a later MERGE write must not overtake this one
+      mergeable.erase(writeKey);
+    }
+    Write write{writeKey, takeBuffer(), Clock::now()};
+    write.data.assign(static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    pendingBytes += size;
+    writes.push_back(std::move(write));
+    if (mode == SendMode::MERGE) {
+      mergeable[writeKey] = firstSequence + writes.size() - 1;
+    }
+    counters.maxDepth = std::max(counters.maxDepth, writes.size());
+  }
+
+  /**
+   * Sends pending writes in queue order until byteBudget bytes are sent.
+   * @return number of writes sent
+   */
+  size_t flush(HANDLE hSimConnect, size_t byteBudget) {
+    batch.clear();
+    {
+      std::lock_guard lock(mutex);
+      size_t bytes = 0;
+      while (!writes.empty() && (batch.empty() || bytes + writes.front().data.size() <= byteBudget)) {
+        Write& write = writes.front();
+        bytes += write.data.size();
+        pendingBytes -= write.data.size();
+        const auto it = mergeable.find(write.key);
+        if (it != mergeable.end() && it->second == firstSequence) {
+          mergeable.erase(it);
+        }
+        batch.push_back(std::move(write));
+        writes.pop_front();
+        firstSequence++;
+      }
+      counters.flushes++;
+      if (!writes.empty()) {
+        counters.budgetLimitedFlushes++;
+      }
+    }
+    if (batch.empty()) {
+      return 0;
+    }
+
+    const auto start = Clock::now();
+    uint64_t sentBytes = 0;
+    uint64_t failed = 0;
+    failedAreas.clear();
+    Clock::duration totalLatency{};
+    Clock::duration maxLatency{};
+    for (auto& write : batch) {
+      if (!SUCCEEDED(SimConnect_SetClientData(hSimConnect, write.key.areaId, write.key.definitionId, SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0,
+                                              static_cast<DWORD>(write.data.size()), write.data.data()))) {
+        traceLog->record(TraceEvent::CLIENT_DATA_SEND_FAILED, write.key.areaId, 0, static_cast<uint32_t>(write.data.size()), write.key.definitionId);
+        LOGF_ERROR_RATE(1, "Setting client data failed: area {} definition {}", write.key.areaId, write.key.definitionId);
+        failed++;
+        failedAreas.push_back(write.key.areaId);
+        continue;
+      }
+      traceLog->record(TraceEvent::CLIENT_DATA_SENT, write.key.areaId, 0, static_cast<uint32_t>(write.data.size()), write.key.definitionId);
+      trafficCapture->recordSent(write.key.areaId, write.key.definitionId, write.data.data(), static_cast<DWORD>(write.data.size()));
+      sentBytes += write.data.size();
+      const auto latency = start - write.queuedAt;
+      totalLatency += latency;
+      maxLatency = std::max(maxLatency, latency);
+    }
+    const auto flushTime = Clock::now() - start;
+
+    std::unique_lock lock(mutex);
+    counters.sent += batch.size() - failed;
+    counters.sentBytes += sentBytes;
+    counters.failed += failed;
+    for (const auto areaId : failedAreas) {
+      counters.failedByArea[areaId]++;
+    }
+    counters.totalLatency += totalLatency;
+    counters.maxLatency = std::max(counters.maxLatency, maxLatency);
+    counters.totalFlushTime += flushTime;
+    counters.maxFlushTime = std::max(counters.maxFlushTime, flushTime);
+    for (auto& write : batch) {
+      returnBuffer(std::move(write.data));
+    }
+    const size_t count = batch.size();
+    batch.clear();
+    lock.unlock();
+    for (const auto areaId : failedAreas) {
+      const auto it = failureHandlers.find(areaId);
+      if (it != failureHandlers.end()) {
+        it->second();
+      }
+    }
+    return count;
+  }
+
+  /** @return number of pending writes */
+  [[nodiscard]] size_t depth() const {
+    std::lock_guard lock(mutex);
+    return writes.size();
+  }
+
+  /** @return number of bytes of the pending writes */
+  [[nodiscard]] size_t depthBytes() const {
+    std::lock_guard lock(mutex);
+    return pendingBytes;
+  }
+
+  [[nodiscard]] Stats stats() const {
+    std::lock_guard lock(mutex);
+    return counters;
+  }
+
+ private:
+  struct WriteKey {
+    SIMCONNECT_CLIENT_DATA_ID areaId;
+    SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId;
+    uint32_t mergeKey;
+
+    bool operator==(const WriteKey& other) const {
+      return areaId == other.areaId && definitionId == other.definitionId && mergeKey == other.mergeKey;
+    }
+  };
+
+  struct WriteKeyHash {
+    size_t operator()(const WriteKey& key) const {
+      return std::hash<uint64_t>{}((static_cast<uint64_t>(key.areaId) << 32 | key.definitionId) ^ (static_cast<uint64_t>(key.mergeKey) << 16));
+    }
+  };
+
+  struct Write {
+    WriteKey key;
+    std::vector<char> data;
+    Clock::time_point queuedAt;
+  };
+
+  mutable std::mutex mutex;
+  std::deque<Write> writes;
+  uint64_t firstSequence = 0;  // sequence number of writes.front() - writes are numbered in queue order
+  std::unordered_map<WriteKey, uint64_t, WriteKeyHash> mergeable;  // sequence of the pending MERGE write per key
+  size_t pendingBytes = 0;
+  std::vector<std::vector<char>> freeBuffers;  // buffers of sent writes - reused to avoid allocations per write
+  Stats counters{};
+  std::vector<Write> batch;  // writes taken out of the queue by the running flush - only used by flush()
+  std::vector<SIMCONNECT_CLIENT_DATA_ID> failedAreas;  // areas of the failed writes of the running flush - only used by flush()
+  std::unordered_map<SIMCONNECT_CLIENT_DATA_ID, std::function<void()>> failureHandlers;
+
+  std::vector<char> takeBuffer() {
+    if (freeBuffers.empty()) {
+      return {};
+    }
+    auto buffer = std::move(freeBuffers.back());
+    freeBuffers.pop_back();
+    return buffer;
+  }
+
+  void returnBuffer(std::vector<char>&& buffer) {
+    buffer.clear();
+    freeBuffers.push_back(std::move(buffer));
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_SENDQUEUE_H
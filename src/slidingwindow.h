@@ -0,0 +1,141 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_SLIDINGWINDOW_H
+#define FBW_CPP_FRAMEWORK_TEST_SLIDINGWINDOW_H
+
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+/**
+ * Sender side of the go-back-N sliding window protocol used for acknowledged streams.
+ *
+ * At most window chunks are unacknowledged at any time. Acks are cumulative. If no ack progress is
+ * made within timeout, all unacknowledged chunks are sent again starting with the oldest. If not even
+ * the first chunk was acknowledged the receiver may not know the transfer at all, e.g. because its
+ * meta data was lost - the start of the transfer is then announced again before the chunks.
+ * The class only does the bookkeeping - sending is done by the functions given to pump().
+ *
+ * Usage:
+ *
+ * SlidingWindowSender window(8, std::chrono::milliseconds(100));
+ * window.start(chunkCount);
+ * window.pump([](uint32_t sequence) { return sendChunk(sequence); },   // in every loop iteration
+ *             [] { sendMetaData(); });
+ * window.onAck(ack.ackedChunks);                                       // when an ack arrives
+ */
+class SlidingWindowSender {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  SlidingWindowSender(uint32_t window, Clock::duration timeout) : windowSize(window), ackTimeout(timeout) {}
+
+  /** Starts a new transfer of chunkCount chunks. */
+  void start(uint32_t chunkCount) {
+    total = chunkCount;
+    base = 0;
+    next = 0;
+    highestSent = 0;
+    sentChunks = 0;
+    retransmittedChunks = 0;
+    timeouts = 0;
+    startResends = 0;
+    lastProgress = Clock::now();
+    active = true;
+  }
+
+  /** Sends chunks as long as the window allows and handles the ack timeout - for transfers without meta data. */
+  template <typename F>
+  uint32_t pump(F&& sendChunk) {
+    return pump(std::forward<F>(sendChunk), [] {});
+  }
+
+  /**
+   * Sends chunks as long as the window allows and handles the ack timeout.
+   * @param sendChunk called with the sequence of each chunk to send - returns false if sending failed
+   * @param resendStart called on an ack timeout before any chunk was acknowledged, ahead of the
+   *        retransmitted chunks - e.g. to send the meta data of the transfer again
+   * @return number of chunks sent
+   */
+  template <typename F, typename G>
+  uint32_t pump(F&& sendChunk, G&& resendStart) {
+    if (!active) {
+      return 0;
+    }
+    const auto now = Clock::now();
+    if (next > base && now - lastProgress > ackTimeout) {
+      // go back N - resend everything not yet acknowledged
+      next = base;
+      timeouts++;
+      lastProgress = now;
+      if (base == 0) {
+        startResends++;
+        resendStart();
+      }
+    }
+    uint32_t sent = 0;
+    while (next < total && next - base < windowSize) {
+      if (!sendChunk(next)) {
+        break;
+      }
+      if (next < highestSent) {
+        retransmittedChunks++;
+      }
+      next++;
+      highestSent = next > highestSent ? next : highestSent;
+      sentChunks++;
+      sent++;
+    }
+    return sent;
+  }
+
+  /**
+   * Processes a cumulative ack. Acks for chunks which have not been sent yet are stale
+   * (e.g. from a previous transfer) and are ignored.
+   * @return true if this ack completed the transfer
+   */
+  bool onAck(uint32_t ackedChunks) {
+    if (!active || ackedChunks <= base || ackedChunks > highestSent) {
+      return false;
+    }
+    base = ackedChunks;
+    if (next < base) {
+      next = base;
+    }
+    lastProgress = Clock::now();
+    if (base >= total) {
+      active = false;
+      return true;
+    }
+    return false;
+  }
+
+  [[nodiscard]] bool isActive() const { return active; }
+  [[nodiscard]] bool isDone() const { return !active && base >= total; }
+  [[nodiscard]] uint32_t window() const { return windowSize; }
+  [[nodiscard]] uint32_t ackedChunks() const { return base; }
+  [[nodiscard]] uint32_t chunkCount() const { return total; }
+  [[nodiscard]] uint64_t sentCount() const { return sentChunks; }
+  [[nodiscard]] uint64_t retransmitCount() const { return retransmittedChunks; }
+  [[nodiscard]] uint64_t timeoutCount() const { return timeouts; }
+  /** @return number of timeouts on which the start of the transfer was announced again */
+  [[nodiscard]] uint64_t startResendCount() const { return startResends; }
+
+ private:
+  uint32_t windowSize;
+  Clock::duration ackTimeout;
+
+  bool active = false;
+  uint32_t total = 0;
+  uint32_t base = 0;         // oldest unacknowledged chunk
+  uint32_t next = 0;         // next chunk to send
+  uint32_t highestSent = 0;  // one past the highest chunk ever sent
+  uint64_t sentChunks = 0;
+  uint64_t retransmittedChunks = 0;
+  uint64_t timeouts = 0;
+  uint64_t startResends = 0;
+  Clock::time_point lastProgress{};
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_SLIDINGWINDOW_H
@@ -0,0 +1,158 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_SPSCRING_H
+#define FBW_CPP_FRAMEWORK_TEST_SPSCRING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+/**
+ * Lock-free single producer / single consumer ring for variable sized messages.
+ *
+ * The buffer is allocated once. Each message is stored contiguously behind an 8 byte header and
+ * padded to 8 bytes so the consumer can use it in place - e.g. as a SIMCONNECT_RECV. A message
+ * which does not fit before the end of the buffer is preceded by a wrap marker and stored at the
+ * start. Exactly one thread may push and exactly one other thread may peek and pop.
+ *
+ * Usage:
+ *
+ * SpscRing ring(1 << 20);
+ * ring.tryPush(pData, cbData);  // producer - false if the ring is full
+ * while (ring.peek(data, size)) {  // consumer
+ *   process(data, size);
+ *   ring.pop();
+ * }
+ */
+class SpscRing {
+ public:
+  /** @param capacityBytes buffer size - rounded up to a multiple of 8 */
+  explicit SpscRing(size_t capacityBytes)
+      : capacity(align(capacityBytes)), buffer(std::make_unique<char[]>(capacity)) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  /** @return the largest message which can be pushed into an empty ring */
+  [[nodiscard]] size_t maxMessageSize() const { return capacity / 2 - sizeof(Header); }
+
+  /**
+   * Copies a message into the ring. Producer only.
+   * @return false if there is not enough free space (or the message is larger than maxMessageSize())
+   */
+  bool tryPush(const void* data, uint32_t size) {
+    if (size > maxMessageSize()) {
+      return false;
+    }
+    const uint64_t head = writePosition.load(std::memory_order_relaxed);
+    const size_t index = head % capacity;
+    const size_t recordSize = align(sizeof(Header) + size);
+    // a record never wraps - the rest of the buffer is skipped if it does not fit
+    const size_t padding = index + recordSize > capacity ? capacity - index : 0;
+    const size_t needed = padding + recordSize;
+    if (capacity - (head - cachedReadPosition) < needed) {
+      cachedReadPosition = readPosition.load(std::memory_order_acquire);
+      if (capacity - (head - cachedReadPosition) < needed) {
+        fullCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    size_t at = index;
+    if (padding > 0) {
+      writeHeader(at, WRAP);
+      at = 0;
+    }
+    writeHeader(at, size);
+    std::memcpy(buffer.get() + at + sizeof(Header), data, size);
+    const uint64_t newHead = head + needed;
+    writePosition.store(newHead, std::memory_order_release);
+    if (newHead - cachedReadPosition > highWater.load(std::memory_order_relaxed)) {
+      highWater.store(newHead - cachedReadPosition, std::memory_order_relaxed);
+    }
+    pushCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * Gets the oldest message without removing it. Consumer only.
+   * The message stays valid and in place until pop().
+   * @return false if the ring is empty
+   */
+  bool peek(const char*& data, uint32_t& size) {
+    uint64_t tail = readPosition.load(std::memory_order_relaxed);
+    if (tail == cachedWritePosition) {
+      cachedWritePosition = writePosition.load(std::memory_order_acquire);
+      if (tail == cachedWritePosition) {
+        return false;
+      }
+    }
+    size_t index = tail % capacity;
+    Header header = readHeader(index);
+    if (header.size == WRAP) {
+      // the producer always writes the record behind a wrap marker before publishing both
+      tail += capacity - index;
+      readPosition.store(tail, std::memory_order_release);
+      index = 0;
+      header = readHeader(index);
+    }
+    data = buffer.get() + index + sizeof(Header);
+    size = header.size;
+    return true;
+  }
+
+  /** Removes the message returned by the last peek(). Consumer only. */
+  void pop() {
+    const uint64_t tail = readPosition.load(std::memory_order_relaxed);
+    const Header header = readHeader(tail % capacity);
+    readPosition.store(tail + align(sizeof(Header) + header.size), std::memory_order_release);
+  }
+
+  /** @return number of messages pushed */
+  [[nodiscard]] uint64_t pushedCount() const { return pushCount.load(std::memory_order_relaxed); }
+  /** @return number of failed pushes because the ring was full */
+  [[nodiscard]] uint64_t fullPushCount() const { return fullCount.load(std::memory_order_relaxed); }
+  /** @return highest number of bytes in use seen by the producer */
+  [[nodiscard]] uint64_t highWaterBytes() const { return highWater.load(std::memory_order_relaxed); }
+  [[nodiscard]] size_t capacityBytes() const { return capacity; }
+
+ private:
+  struct Header {
+    uint32_t size;
+    uint32_t reserved;
+  };
+  static constexpr uint32_t WRAP = 0xFFFFFFFF;
+  static constexpr size_t CACHE_LINE = 64;
+
+  static constexpr size_t align(size_t size) { return (size + 7) & ~size_t{7}; }
+
+  void writeHeader(size_t index, uint32_t size) {
+    const Header header{size, 0};
+    std::memcpy(buffer.get() + index, &header, sizeof(header));
+  }
+
+  [[nodiscard]] Header readHeader(size_t index) const {
+    Header header{};
+    std::memcpy(&header, buffer.get() + index, sizeof(header));
+    return header;
+  }
+
+  const size_t capacity;
+  const std::unique_ptr<char[]> buffer;
+
+  // producer and consumer positions on their own cache lines - each side keeps a copy of the
+  // other side's position and only reloads it when the copy says full or empty
+  alignas(CACHE_LINE) std::atomic<uint64_t> writePosition{0};
+  uint64_t cachedReadPosition = 0;
+  // statistics are written by the producer only but may be read from any thread
+  std::atomic<uint64_t> pushCount{0};
+  std::atomic<uint64_t> fullCount{0};
+  std::atomic<uint64_t> highWater{0};
+
+  alignas(CACHE_LINE) std::atomic<uint64_t> readPosition{0};
+  uint64_t cachedWritePosition = 0;
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_SPSCRING_H
@@ -0,0 +1,239 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_STREAMDEMULTIPLEXER_H
+#define FBW_CPP_FRAMEWORK_TEST_STREAMDEMULTIPLEXER_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "bufferpool.h"
+#include "streamprotocol.h"
+#include "streamreassembler.h"
+#include "streamsink.h"
+
+/**
+ * Receiver side of concurrent streams sharing the same data areas.
+ *
+ * Every stream ID has its own StreamReassembler. Chunks are routed by the stream ID in their
+ * header, so a small stream started while a large one is in progress completes on its own and
+ * neither aborts nor waits for the other. A new meta data message only restarts the stream with
+ * the same ID.
+ *
+ * The progress handler is called after every chunk of a stream (e.g. to acknowledge it), the
+ * completion handler once when the stream is complete - a handler for the stream ID takes
+ * precedence over the default one. The stream buffer goes back to the pool after the completion
+ * handler. A completed stream is remembered until its slot is needed, so retransmitted chunks of
+ * it are still acknowledged.
+ *
+ * A stream ID can be given a StreamSink so its chunks are written straight into the consumer's
+ * destination instead of a pooled stream buffer.
+ *
+ * Usage:
+ *
+ * StreamDemultiplexer streams(&bufferPool, 4);
+ * streams.onProgress([](uint32_t id, const StreamReassembler& stream) { ack(id, stream.ackedChunks()); });
+ * streams.onComplete([](uint32_t id, const StreamReassembler& stream) { verify(stream.data()); });
+ * streams.start(metaData);  // for every meta data message
+ * streams.onChunk(chunk);   // for every chunk
+ */
+class StreamDemultiplexer {
+ public:
+  using Handler = std::function<void(uint32_t streamId, const StreamReassembler& stream)>;
+
+  /** Counters of the demultiplexer. */
+  struct Stats {
+    uint64_t started = 0;
+    uint64_t completed = 0;
+    /** streams started again with the same ID before they were complete */
+    uint64_t restarted = 0;
+    /** streams not started because maxStreams streams were in progress */
+    uint64_t rejected = 0;
+    /** streams not started because their meta data was invalid - see StreamReassembler::start() */
+    uint64_t invalid = 0;
+    /** chunks of unknown streams */
+    uint64_t orphanChunks = 0;
+  };
+
+  /**
+   * @param bufferPool pool of the stream buffers - nullptr lets every stream keep its own buffer
+   * @param maxStreams number of streams which can be in progress at the same time
+   */
+  StreamDemultiplexer(BufferPool* bufferPool, size_t maxStreams) {
+    slots.reserve(maxStreams);
+    for (size_t i = 0; i < maxStreams; i++) {
+      slots.push_back(std::make_unique<Slot>(bufferPool));
+    }
+  }
+
+  /** Sets the handler called after every chunk of any stream. */
+  void onProgress(Handler handler) { progressHandler = std::move(handler); }
+
+  /** Sets the handler called when a stream without its own completion handler is complete. */
+  void onComplete(Handler handler) { defaultCompletionHandler = std::move(handler); }
+
+  /** Sets the handler called when the stream with the given ID is complete. */
+  void onComplete(uint32_t streamId, Handler handler) {
+    for (auto& [id, h] : completionHandlers) {
+      if (id == streamId) {
+        h = std::move(handler);
+        return;
+      }
+    }
+    completionHandlers.emplace_back(streamId, std::move(handler));
+  }
+
+  /** Sets the destination of the streams with the given ID - nullptr reverts to the pooled stream buffers. */
+  void setSink(uint32_t streamId, StreamSink* sink) {
+    for (auto& [id, s] : sinks) {
+      if (id == streamId) {
+        s = sink;
+        return;
+      }
+    }
+    sinks.emplace_back(streamId, sink);
+  }
+
+  /**
+   * Starts the stream described by the meta data - a stream with the same ID is restarted.
+   * @return false if maxStreams other streams are in progress or the meta data is invalid
+   */
+  bool start(const StreamMetaData& metaData) {
+    Slot* target = find(metaData.streamId);
+    if (target != nullptr && target->state == State::RECEIVING) {
+      counters.restarted++;
+    }
+    if (target == nullptr) {
+      // a free slot, otherwise the one of the oldest completed stream
+      for (auto& slot : slots) {
+        if (slot->state == State::FREE) {
+          target = slot.get();
+          break;
+        }
+        if (slot->state == State::COMPLETE && (target == nullptr || slot->started < target->started)) {
+          target = slot.get();
+        }
+      }
+    }
+    if (target == nullptr) {
+      counters.rejected++;
+      return false;
+    }
+    if (headerless == target) {
+      headerless = nullptr;
+    }
+    if (!target->reassembler.start(metaData, sinkOf(metaData.streamId))) {
+      target->state = State::FREE;
+      counters.invalid++;
+      return false;
+    }
+    target->streamId = metaData.streamId;
+    target->state = State::RECEIVING;
+    target->started = ++startCount;
+    if (!hasChunkHeader(metaData)) {
+      headerless = target;
+    }
+    counters.started++;
+    return true;
+  }
+
+  /**
+   * Routes a chunk of StreamChunkSize bytes to its stream.
+   * @return false if the chunk does not belong to a known stream
+   */
+  bool onChunk(const char* chunk) {
+    Slot* target = headerless;
+    if (target == nullptr) {
+      StreamChunkHeader header{};
+      std::memcpy(&header, chunk, sizeof(header));
+      target = find(header.streamId);
+    }
+    if (target == nullptr) {
+      counters.orphanChunks++;
+      return false;
+    }
+    const bool completed = target->reassembler.onChunk(chunk);
+    if (progressHandler) {
+      progressHandler(target->streamId, target->reassembler);
+    }
+    if (completed) {
+      const Handler& handler = completionHandler(target->streamId);
+      if (handler) {
+        handler(target->streamId, target->reassembler);
+      }
+      target->reassembler.release();
+      target->state = State::COMPLETE;
+      if (headerless == target) {
+        headerless = nullptr;
+      }
+      counters.completed++;
+    }
+    return true;
+  }
+
+  /** @return number of streams in progress */
+  [[nodiscard]] size_t activeCount() const {
+    size_t count = 0;
+    for (const auto& slot : slots) {
+      count += slot->state == State::RECEIVING ? 1 : 0;
+    }
+    return count;
+  }
+
+  [[nodiscard]] const Stats& stats() const { return counters; }
+
+ private:
+  enum class State { FREE, RECEIVING, COMPLETE };
+
+  struct Slot {
+    explicit Slot(BufferPool* bufferPool) : reassembler(bufferPool) {}
+    uint32_t streamId = 0;
+    State state = State::FREE;
+    uint64_t started = 0;  // start order - the oldest completed slot is reused first
+    StreamReassembler reassembler;
+  };
+
+  // allocated up front - starting a stream does not allocate
+  std::vector<std::unique_ptr<Slot>> slots;
+  // stream in progress whose chunks have no header - it takes every chunk
+  Slot* headerless = nullptr;
+  Handler progressHandler;
+  Handler defaultCompletionHandler;
+  std::vector<std::pair<uint32_t, Handler>> completionHandlers;
+  std::vector<std::pair<uint32_t, StreamSink*>> sinks;
+  uint64_t startCount = 0;
+  Stats counters{};
+
+  Slot* find(uint32_t streamId) {
+    for (auto& slot : slots) {
+      if (slot->state != State::FREE && slot->streamId == streamId) {
+        return slot.get();
+      }
+    }
+    return nullptr;
+  }
+
+  StreamSink* sinkOf(uint32_t streamId) const {
+    for (const auto& [id, sink] : sinks) {
+      if (id == streamId) {
+        return sink;
+      }
+    }
+    return nullptr;
+  }
+
+  const Handler& completionHandler(uint32_t streamId) const {
+    for (const auto& [id, handler] : completionHandlers) {
+      if (id == streamId) {
+        return handler;
+      }
+    }
+    return defaultCompletionHandler;
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_STREAMDEMULTIPLEXER_H
@@ -0,0 +1,74 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_STREAMPROTOCOL_H
+#define FBW_CPP_FRAMEWORK_TEST_STREAMPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "compression.h"
+#include "fingerprint.h"
+
+/**
+ * Wire format of the streaming client data areas shared with the WASM side.
+ *
+ * A stream starts with a StreamMetaData on the META DATA area followed by chunks of StreamChunkSize
+ * bytes on the DATA area(s). In tree mode the chunk hashes are sent as chunks ahead of the data.
+ * If chunks can arrive out of order or need acknowledgement (ackWindow > 0 or stripeCount > 1)
+ * every chunk starts with a StreamChunkHeader. Compressed streams transfer the compressed bytes -
+ * size and hash always refer to the original data.
+ *
+ * Streams with different stream IDs are transferred concurrently over the same areas. Their chunks
+ * always carry a StreamChunkHeader with the stream ID and acks name the stream they acknowledge.
+ * Stream ID 0 is the single stream of the original protocol - without ack or stripes its chunks
+ * have no header, so it must not overlap other streams.
+ */
+
+/** size of every chunk on the wire - SIMCONNECT_CLIENTDATA_MAX_SIZE */
+constexpr size_t StreamChunkSize = 8192;
+
+struct StreamMetaData {
+  size_t size;
+  size_t hash;
+  FingerprintAlgorithm algorithm;  // algorithm used for hash
+  uint32_t chunkHashCount;         // 0 = hash is flat; >0 = hash is the tree root and the chunk hashes precede the data
+  uint32_t ackWindow;              // 0 = chunks are not acknowledged; >0 = the receiver acks chunks
+  uint32_t stripeCount;            // number of data areas the chunks are distributed over round-robin
+  StreamCompression compression;   // compression of the data on the wire
+  size_t compressedSize;           // number of data bytes on the wire if compressed
+  uint32_t streamId;               // streams with different IDs are transferred concurrently - see hasChunkHeader()
+} __attribute__((packed));
+
+/**
+ * Header in front of every chunk of a multiplexed, acknowledged or striped stream.
+ */
+struct StreamChunkHeader {
+  uint32_t sequence;  // index of the chunk in the stream
+  uint32_t streamId;  // stream the chunk belongs to
+} __attribute__((packed));
+
+/**
+ * Acknowledgement written by the receiver of an acknowledged stream.
+ */
+struct StreamAck {
+  uint32_t ackedChunks;  // number of chunks received without gap - the next expected sequence
+  uint32_t streamId;     // stream the ack belongs to
+} __attribute__((packed));
+
+/** @return true if the chunks of the stream start with a StreamChunkHeader */
+constexpr bool hasChunkHeader(const StreamMetaData& metaData) {
+  return metaData.streamId != 0 || metaData.ackWindow > 0 || metaData.stripeCount > 1;
+}
+
+/** @return the number of data bytes transferred in chunks */
+constexpr size_t streamWireSize(const StreamMetaData& metaData) {
+  return metaData.compression == StreamCompression::NONE ? metaData.size : metaData.compressedSize;
+}
+
+/** @return the number of stream bytes carried by one chunk */
+constexpr size_t streamChunkPayloadSize(bool withHeader) {
+  return withHeader ? StreamChunkSize - sizeof(StreamChunkHeader) : StreamChunkSize;
+}
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_STREAMPROTOCOL_H
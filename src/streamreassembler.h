@@ -0,0 +1,255 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_STREAMREASSEMBLER_H
+#define FBW_CPP_FRAMEWORK_TEST_STREAMREASSEMBLER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "bufferpool.h"
+#include "fingerprint.h"
+#include "logging.h"
+#include "streamprotocol.h"
+#include "streamsink.h"
+#include "treefingerprint.h"
+
+/**
+ * Receiver side of a stream. Places every chunk at its final position by chunk index, so chunks of
+ * striped streams may arrive in any order, and ignores duplicates from retransmissions.
+ * The flat fingerprint of uncompressed streams is updated incrementally as the gap-free prefix of
+ * the stream grows. Compressed streams are kept as received - see data().
+ *
+ * With a buffer pool the stream buffer is taken from the pool at start() and given back with
+ * release() once the data has been verified, so consecutive streams of varying size reuse buffers.
+ * With a StreamSink the chunks are written into the destination of the sink instead - data() then
+ * refers to that destination.
+ *
+ * The meta data comes from the wire, so start() checks its sizes and counts before allocating and
+ * rejects streams it cannot hold.
+ *
+ * Usage:
+ *
+ * if (!reassembler.start(metaData)) { return; }  // or start(metaData, &sink)
+ * if (reassembler.onChunk(chunk)) { // complete
+ *   const bool match = reassembler.digest() == metaData.hash;
+ *   reassembler.release();
+ * }
+ */
+class StreamReassembler {
+ public:
+  /** largest stream accepted - larger sizes are taken as corrupt meta data */
+  static constexpr size_t MAX_STREAM_SIZE = size_t{1} << 40;
+  /** largest stream received into a stream buffer - larger streams need a sink. Also bounds decompressed streams and the chunk hashes. */
+  static constexpr size_t MAX_BUFFERED_SIZE = size_t{1} << 30;
+
+  /** @param bufferPool pool of the stream buffers - nullptr keeps one buffer of its own */
+  explicit StreamReassembler(BufferPool* bufferPool = nullptr) : pool(bufferPool) {}
+
+  StreamReassembler(const StreamReassembler&) = delete;
+  StreamReassembler& operator=(const StreamReassembler&) = delete;
+
+  ~StreamReassembler() { release(); }
+
+  /**
+   * Starts a new stream and discards any stream in progress.
+   * @param streamSink destination of the stream data - nullptr or a sink without room uses the stream buffer, a sink whose
+   *                   destination is too small is closed right away
+   * @return false if the meta data is invalid or the stream needs a larger stream buffer than MAX_BUFFERED_SIZE - nothing is
+   *         allocated, the stream is logged and ignored and its chunks count as duplicates
+   */
+  bool start(const StreamMetaData& metaData, StreamSink* streamSink = nullptr) {
+    release();
+    meta = metaData;
+    withHeader = hasChunkHeader(meta);
+    payloadSize = streamChunkPayloadSize(withHeader);
+    const size_t size = streamWireSize(meta);
+    if (const char* error = metaDataError()) {
+      LOGF_WARN_RATE(1, "Rejected stream {}: {}", meta.streamId, error);
+      reset();
+      return false;
+    }
+    // decide where the data goes before anything is allocated for the stream
+    destination = streamSink != nullptr ? streamSink->open(meta, size) : std::span<char>{};
+    if (streamSink != nullptr && destination.size() >= size) {
+      sink = streamSink;
+      destination = destination.first(size);
+    } else {
+      if (!destination.empty()) {
+        // the sink provided a destination too small for the stream - it is not written
+        streamSink->close(false);
+      }
+      if (size > MAX_BUFFERED_SIZE) {
+        LOGF_WARN_RATE(1, "Rejected stream {}: {} bytes are too large for a stream buffer", meta.streamId, size);
+        reset();
+        return false;
+      }
+      if (pool != nullptr) {
+        // every byte is overwritten by a chunk - the pooled buffer does not need to be cleared
+        buffer = pool->acquire(size);
+        destination = buffer;
+      } else {
+        buffer.clear();
+        buffer.resize(size);
+        destination = buffer;
+      }
+    }
+    hashes.assign(meta.chunkHashCount, 0);
+    hashChunkCount = static_cast<uint32_t>(::chunkCount(hashes.size() * sizeof(uint64_t), payloadSize));
+    totalChunks = hashChunkCount + static_cast<uint32_t>(::chunkCount(size, payloadSize));
+    received.assign(totalChunks, 0);
+    hasher.reset(meta.algorithm);
+    startedAt = std::chrono::steady_clock::now();
+    bytes = 0;
+    uniqueChunks = 0;
+    duplicates = 0;
+    contiguous = 0;
+    return true;
+  }
+
+  /**
+   * Processes one chunk of StreamChunkSize bytes as received from the data area.
+   * @return true if this chunk completed the stream
+   */
+  bool onChunk(const char* chunk) {
+    uint32_t index = uniqueChunks;
+    if (withHeader) {
+      StreamChunkHeader header{};
+      std::memcpy(&header, chunk, sizeof(header));
+      index = header.sequence;
+      chunk += sizeof(StreamChunkHeader);
+    }
+    if (index >= totalChunks || received[index]) {
+      duplicates++;
+      return false;
+    }
+    received[index] = 1;
+    uniqueChunks++;
+
+    if (index < hashChunkCount) {
+      // in tree mode the chunk hashes precede the data
+      const size_t offset = index * payloadSize;
+      const size_t size = std::min(payloadSize, hashes.size() * sizeof(uint64_t) - offset);
+      std::memcpy(reinterpret_cast<char*>(hashes.data()) + offset, chunk, size);
+    } else {
+      const size_t offset = (index - hashChunkCount) * payloadSize;
+      const size_t size = std::min(payloadSize, destination.size() - offset);
+      std::memcpy(destination.data() + offset, chunk, size);
+      bytes += size;
+      if (sink != nullptr) {
+        sink->written(offset, size);
+      }
+    }
+
+    // extend the gap-free prefix and fingerprint the data which became contiguous
+    while (contiguous < totalChunks && received[contiguous]) {
+      if (contiguous >= hashChunkCount && hashes.empty() && meta.compression == StreamCompression::NONE) {
+        const size_t offset = (contiguous - hashChunkCount) * payloadSize;
+        hasher.update(destination.data() + offset, std::min(payloadSize, destination.size() - offset));
+      }
+      contiguous++;
+    }
+    return isComplete();
+  }
+
+  /** Closes the sink or gives the stream buffer back to the pool - data() is empty afterwards. */
+  void release() {
+    if (sink != nullptr) {
+      sink->close(isComplete());
+      sink = nullptr;
+      destination = {};
+    } else if (pool != nullptr) {
+      pool->release(std::move(buffer));
+      buffer = {};
+      destination = {};
+    }
+  }
+
+  [[nodiscard]] bool isComplete() const { return contiguous == totalChunks; }
+  /** @return the number of chunks received without gap - the value to ack */
+  [[nodiscard]] uint32_t ackedChunks() const { return contiguous; }
+  [[nodiscard]] const StreamMetaData& metaData() const { return meta; }
+  /** @return when start() was called - e.g. to measure the reassembly time */
+  [[nodiscard]] std::chrono::steady_clock::time_point startTime() const { return startedAt; }
+  /** @return the data as received - still compressed if metaData().compression is set */
+  [[nodiscard]] std::span<const char> data() const { return destination; }
+  /** @return true if the stream is written to a sink */
+  [[nodiscard]] bool usesSink() const { return sink != nullptr; }
+  [[nodiscard]] const std::vector<uint64_t>& chunkHashes() const { return hashes; }
+  /** @return the flat fingerprint of the data received so far - only maintained for uncompressed streams */
+  [[nodiscard]] uint64_t digest() const { return hasher.digest(); }
+  [[nodiscard]] size_t receivedBytes() const { return bytes; }
+  [[nodiscard]] uint32_t receivedChunks() const { return uniqueChunks; }
+  [[nodiscard]] uint32_t duplicateChunks() const { return duplicates; }
+  [[nodiscard]] uint32_t chunkCount() const { return totalChunks; }
+
+ private:
+  BufferPool* pool;
+  StreamMetaData meta{};
+  bool withHeader = false;
+  size_t payloadSize = StreamChunkSize;
+  uint32_t hashChunkCount = 0;
+  uint32_t totalChunks = 0;
+  std::vector<char> buffer;
+  StreamSink* sink = nullptr;
+  // where the chunks are written - the sink's destination or the stream buffer
+  std::span<char> destination;
+  std::vector<uint64_t> hashes;
+  std::vector<char> received;
+  Fingerprinter hasher{};
+  std::chrono::steady_clock::time_point startedAt{};
+  size_t bytes = 0;
+  uint32_t uniqueChunks = 0;
+  uint32_t duplicates = 0;
+  uint32_t contiguous = 0;
+
+  /** @return nullptr if the stream of meta can be received, otherwise why not - checks everything not depending on the sink */
+  [[nodiscard]] const char* metaDataError() const {
+    if (meta.size == 0) {
+      // no chunk would ever complete it
+      return "empty stream";
+    }
+    if (meta.size > MAX_STREAM_SIZE || streamWireSize(meta) > MAX_STREAM_SIZE) {
+      return "size too large";
+    }
+    if (meta.compression != StreamCompression::NONE) {
+      if (meta.compression != StreamCompression::LZ4) {
+        return "unknown compression";
+      }
+      // only compressed if that saves bytes
+      if (meta.compressedSize > meta.size) {
+        return "compressed size larger than the size";
+      }
+      // decompressed into a stream buffer once complete
+      if (meta.size > MAX_BUFFERED_SIZE) {
+        return "too large to decompress into a stream buffer";
+      }
+    }
+    // the chunk hashes are the leaves of the tree fingerprint - one per data chunk of the original data, always kept in memory
+    if (meta.chunkHashCount != 0 && meta.chunkHashCount != ::chunkCount(meta.size, payloadSize)) {
+      return "chunk hash count does not match the size";
+    }
+    if (meta.chunkHashCount > MAX_BUFFERED_SIZE / sizeof(uint64_t)) {
+      return "too many chunk hashes";
+    }
+    return nullptr;
+  }
+
+  /** Forgets the stream - no chunk is accepted until the next start(). */
+  void reset() {
+    hashes.clear();
+    received.clear();
+    hashChunkCount = 0;
+    totalChunks = 0;
+    destination = {};
+    bytes = 0;
+    uniqueChunks = 0;
+    duplicates = 0;
+    contiguous = 0;
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_STREAMREASSEMBLER_H
@@ -0,0 +1,73 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_STREAMSINK_H
+#define FBW_CPP_FRAMEWORK_TEST_STREAMSINK_H
+
+#include <cstddef>
+#include <span>
+
+#include "streamprotocol.h"
+
+/**
+ * Destination of a received stream provided by its consumer.
+ *
+ * The StreamReassembler writes every chunk once, straight at its final offset in the destination -
+ * e.g. a preallocated buffer, an array of structs or a memory-mapped file region - so the data does
+ * not have to be copied out of a reassembly buffer afterwards. Compressed streams are written as
+ * received, i.e. the destination holds the compressed bytes.
+ *
+ * Usage:
+ *
+ * class MySink : public StreamSink {
+ *   std::span<char> open(const StreamMetaData& metaData, size_t size) override { return {target, size}; }
+ *   void close(bool complete) override { if (complete) use(target); }
+ * };
+ */
+class StreamSink {
+ public:
+  virtual ~StreamSink() = default;
+
+  /**
+   * Provides the destination of a new stream - called by StreamReassembler::start().
+   * @param size number of bytes of the stream on the wire
+   * @return size writable bytes - an empty span lets the reassembler use its own buffer instead
+   */
+  virtual std::span<char> open(const StreamMetaData& metaData, size_t size) = 0;
+
+  /** Called after size bytes were written at offset - e.g. to report progress. */
+  virtual void written([[maybe_unused]] size_t offset, [[maybe_unused]] size_t size) {}
+
+  /**
+   * Called when the destination is no longer written - only if open() provided one.
+   * @param complete false if the stream was abandoned, e.g. restarted before it was complete
+   */
+  virtual void close([[maybe_unused]] bool complete) {}
+};
+
+/**
+ * Sink writing into a caller-provided buffer, e.g. a struct or an array of structs.
+ * Streams larger than the buffer are not written to it.
+ */
+class BufferSink : public StreamSink {
+ public:
+  BufferSink(void* destination, size_t capacity) : destination(static_cast<char*>(destination)), capacity(capacity) {}
+
+  std::span<char> open([[maybe_unused]] const StreamMetaData& metaData, size_t size) override {
+    if (size > capacity) {
+      return {};
+    }
+    filled = size;
+    return {destination, size};
+  }
+
+  /** @return the bytes of the last stream written to the buffer */
+  [[nodiscard]] std::span<const char> data() const { return {destination, filled}; }
+
+ private:
+  char* destination;
+  size_t capacity;
+  size_t filled = 0;
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_STREAMSINK_H
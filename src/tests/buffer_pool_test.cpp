@@ -0,0 +1,52 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+// Checks that BufferPool serves sizes above its largest size class without pooling them.
+//
+// The size class of such a size used to be searched without an upper bound - shifting past the
+// width of size_t and indexing beyond the free lists.
+
+#include <cstdint>
+#include <iostream>
+#include <utility>
+
+#include "bufferpool.h"
+
+namespace {
+
+constexpr size_t MAX_RESIDENT_BYTES = 4 * 1024 * 1024;
+constexpr size_t MAX_CLASS_SIZE = 64 * 1024;
+constexpr size_t OVERSIZED = 1024 * 1024 + 1;
+
+}  // namespace
+
+int main() {
+  BufferPool pool(MAX_RESIDENT_BYTES, MAX_CLASS_SIZE);
+
+  // a size of the largest class is pooled
+  auto buffer = pool.acquire(MAX_CLASS_SIZE);
+  pool.release(std::move(buffer));
+  buffer = pool.acquire(MAX_CLASS_SIZE);
+  if (pool.stats().hits != 1 || buffer.size() != MAX_CLASS_SIZE) {
+    std::cerr << "FAIL: largest class not pooled (hits " << pool.stats().hits << ")" << std::endl;
+    return 1;
+  }
+  pool.release(std::move(buffer));
+
+  // a size above the largest class is allocated and freed without the pool
+  auto oversized = pool.acquire(OVERSIZED);
+  if (oversized.size() != OVERSIZED || pool.stats().unpooled != 1) {
+    std::cerr << "FAIL: oversized buffer of " << oversized.size() << " bytes, unpooled " << pool.stats().unpooled << std::endl;
+    return 1;
+  }
+  const size_t resident = pool.stats().residentBytes;
+  pool.release(std::move(oversized));
+  if (pool.stats().residentBytes != resident || pool.stats().outstandingBytes != 0) {
+    std::cerr << "FAIL: oversized buffer pooled (resident " << pool.stats().residentBytes << " bytes, in use "
+              << pool.stats().outstandingBytes << " bytes)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
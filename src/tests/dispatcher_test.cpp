@@ -0,0 +1,57 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+// Checks that a handler can replace and remove itself while it is being dispatched.
+//
+// Destroying the running std::function would destroy the handler being executed, so the Dispatcher
+// has to keep it alive until the call returns and only then apply the change.
+
+#include <iostream>
+#include <string>
+
+#include <SimConnect.h>
+
+#include "dispatcher.h"
+
+int main() {
+  Dispatcher dispatcher;
+  SIMCONNECT_RECV recv{};
+  recv.dwID = SIMCONNECT_RECV_ID_QUIT;
+  std::string calls;
+
+  // replaces itself, then uses its own captured state
+  const std::string first = "first ";
+  dispatcher.on(SIMCONNECT_RECV_ID_QUIT, "first", [&dispatcher, &calls, first](const SIMCONNECT_RECV*, DWORD) {
+    dispatcher.on(SIMCONNECT_RECV_ID_QUIT, "second", [&dispatcher, &calls](const SIMCONNECT_RECV*, DWORD) {
+      // removes itself, then replaces the removal
+      dispatcher.remove(SIMCONNECT_RECV_ID_QUIT);
+      dispatcher.on(SIMCONNECT_RECV_ID_QUIT, "third", [&dispatcher, &calls](const SIMCONNECT_RECV*, DWORD) {
+        // replaces itself, then removes the replacement
+        dispatcher.on(SIMCONNECT_RECV_ID_QUIT, "unused", [&calls](const SIMCONNECT_RECV*, DWORD) { calls += "unused "; });
+        dispatcher.remove(SIMCONNECT_RECV_ID_QUIT);
+        calls += "third ";
+      });
+      calls += "second ";
+    });
+    calls += first;
+  });
+
+  for (int i = 0; i < 4; i++) {
+    dispatcher.dispatch(&recv, sizeof(recv));
+  }
+  const std::string expected = "first second third ";
+  if (calls != expected) {
+    std::cerr << "FAIL: expected calls \"" << expected << "\", got \"" << calls << "\"" << std::endl;
+    return 1;
+  }
+  if (dispatcher.unhandledCount() != 1) {
+    std::cerr << "FAIL: expected 1 unhandled message, got " << dispatcher.unhandledCount() << std::endl;
+    return 1;
+  }
+  if (!dispatcher.stats().empty()) {
+    std::cerr << "FAIL: removed handlers still reported in the statistics" << std::endl;
+    return 1;
+  }
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+// Checks that client data whose queued write failed is written again.
+//
+// TrackedClientData and ClientDataDeltaWriter count their data as written once it is queued. When
+// the SendQueue fails to send it, the owners must be told through the failure handler - otherwise
+// they skip the unchanged data from then on and the sim keeps the stale content.
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <SimConnect.h>
+
+#include "clientdatadelta.h"
+#include "sendqueue.h"
+#include "trackedclientdata.h"
+
+namespace {
+
+constexpr SIMCONNECT_CLIENT_DATA_ID TRACKED_ID = 0;
+constexpr SIMCONNECT_CLIENT_DATA_ID DELTA_ID = 1;
+constexpr SIMCONNECT_CLIENT_DATA_DEFINITION_ID TRACKED_DEFINITION_ID = 0;
+constexpr SIMCONNECT_CLIENT_DATA_DEFINITION_ID DELTA_DEFINITION_ID = 1;
+constexpr SIMCONNECT_CLIENT_DATA_DEFINITION_ID DELTA_PAGE_DEFINITION_ID = 2;
+constexpr uint32_t PAGE_SIZE = 64;
+constexpr size_t DELTA_SIZE = 4 * PAGE_SIZE;
+
+struct TrackedData {
+  int32_t a;
+  int32_t b;
+};
+
+// a handle the loopback does not know - every SimConnect call with it fails
+const HANDLE INVALID_HANDLE = nullptr;
+
+}  // namespace
+
+int main() {
+  HANDLE hSimConnect{};
+  if (!SUCCEEDED(SimConnect_Open(&hSimConnect, "Send Queue Failure Test", nullptr, 0, nullptr, 0))) {
+    std::cerr << "FAIL: cannot open the loopback" << std::endl;
+    return 1;
+  }
+  SimConnect_MapClientDataNameToID(hSimConnect, "TEST TRACKED", TRACKED_ID);
+  SimConnect_CreateClientData(hSimConnect, TRACKED_ID, sizeof(TrackedData), SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT);
+  SimConnect_AddToClientDataDefinition(hSimConnect, TRACKED_DEFINITION_ID, 0, sizeof(TrackedData));
+  SimConnect_MapClientDataNameToID(hSimConnect, "TEST DELTA", DELTA_ID);
+  SimConnect_CreateClientData(hSimConnect, DELTA_ID, DELTA_SIZE, SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT);
+  SimConnect_AddToClientDataDefinition(hSimConnect, DELTA_DEFINITION_ID, 0, DELTA_SIZE);
+
+  TrackedClientData<TrackedData> tracked(TRACKED_ID, TRACKED_DEFINITION_ID);
+  std::vector<char> deltaData(DELTA_SIZE, 1);
+  ClientDataDeltaWriter deltaWriter(DELTA_ID, DELTA_DEFINITION_ID, DELTA_PAGE_DEFINITION_ID, DELTA_SIZE, PAGE_SIZE, 0);
+  SendQueue sendQueue{};
+  sendQueue.onFailed(TRACKED_ID, [&tracked] { tracked.markStale(); });
+  sendQueue.onFailed(DELTA_ID, [&deltaWriter] { deltaWriter.markStale(); });
+
+  // queued - both count as written
+  tracked.set(&TrackedData::a, 1);
+  tracked.flush(hSimConnect, &sendQueue);
+  deltaWriter.write(hSimConnect, deltaData.data(), &sendQueue);
+  if (tracked.isDirty()) {
+    std::cerr << "FAIL: tracked data dirty after queueing" << std::endl;
+    return 1;
+  }
+
+  // the flush fails - both have to be written again
+  sendQueue.flush(INVALID_HANDLE, SIMCONNECT_CLIENTDATA_MAX_SIZE);
+  if (sendQueue.stats().failed != 2) {
+    std::cerr << "FAIL: expected 2 failed writes, got " << sendQueue.stats().failed << std::endl;
+    return 1;
+  }
+  if (!tracked.isDirty()) {
+    std::cerr << "FAIL: tracked data not dirty after its write failed" << std::endl;
+    return 1;
+  }
+  const uint64_t deltaWrites = deltaWriter.rangeWriteCount();
+  deltaWriter.write(hSimConnect, deltaData.data(), &sendQueue);
+  if (deltaWriter.rangeWriteCount() == deltaWrites || deltaWriter.skippedWriteCount() != 0) {
+    std::cerr << "FAIL: unchanged delta data not written again after its write failed" << std::endl;
+    return 1;
+  }
+
+  // written again with a working connection
+  tracked.flush(hSimConnect, &sendQueue);
+  sendQueue.flush(hSimConnect, SIMCONNECT_CLIENTDATA_MAX_SIZE);
+  SimConnect_Close(hSimConnect);
+  const auto stats = sendQueue.stats();
+  std::cout << "sent: " << stats.sent << " failed: " << stats.failed << std::endl;
+  if (stats.sent != 2 || stats.failed != 2 || tracked.isDirty()) {
+    std::cerr << "FAIL: data not written again (sent " << stats.sent << ", tracked dirty " << tracked.isDirty() << ")" << std::endl;
+    return 1;
+  }
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
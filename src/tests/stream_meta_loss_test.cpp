@@ -0,0 +1,179 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+// Checks that an acknowledged stream completes over the SimConnect loopback when its first meta data
+// message is lost.
+//
+// Without meta data the receiver does not know the stream, drops every chunk and never acks. The
+// sender has to announce the stream again on the ack timeout - otherwise it retransmits its window
+// forever.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SimConnect.h>
+#include "SimConnectLoopback.h"
+
+#include "fingerprint.h"
+#include "longtext.h"
+#include "slidingwindow.h"
+#include "streamdemultiplexer.h"
+#include "streamprotocol.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr SIMCONNECT_CLIENT_DATA_DEFINITION_ID META_DEFINITION_ID = 0;
+constexpr SIMCONNECT_CLIENT_DATA_DEFINITION_ID CHUNK_DEFINITION_ID = 1;
+constexpr SIMCONNECT_CLIENT_DATA_DEFINITION_ID ACK_DEFINITION_ID = 2;
+constexpr SIMCONNECT_CLIENT_DATA_ID META_ID = 0;
+constexpr SIMCONNECT_CLIENT_DATA_ID META_ECHO_ID = 1;
+constexpr SIMCONNECT_CLIENT_DATA_ID DATA_ID = 2;
+constexpr SIMCONNECT_CLIENT_DATA_ID DATA_ECHO_ID = 3;
+constexpr SIMCONNECT_CLIENT_DATA_ID ACK_ID = 4;
+constexpr SIMCONNECT_CLIENT_DATA_ID ACK_ECHO_ID = 5;
+constexpr SIMCONNECT_DATA_REQUEST_ID META_REQUEST_ID = 0;
+constexpr SIMCONNECT_DATA_REQUEST_ID DATA_REQUEST_ID = 1;
+constexpr SIMCONNECT_DATA_REQUEST_ID ACK_REQUEST_ID = 2;
+
+const std::string META_NAME = "TEST META";
+const std::string META_ECHO_NAME = "TEST META ECHO";
+const std::string DATA_NAME = "TEST DATA";
+const std::string DATA_ECHO_NAME = "TEST DATA ECHO";
+const std::string ACK_NAME = "TEST ACK";
+const std::string ACK_ECHO_NAME = "TEST ACK ECHO";
+
+constexpr uint32_t STREAM_ID = 1;
+constexpr uint32_t WINDOW = 4;
+constexpr auto ACK_TIMEOUT = std::chrono::milliseconds(50);
+constexpr auto TEST_TIMEOUT = std::chrono::seconds(10);
+
+void createArea(HANDLE hSimConnect, const std::string& name, SIMCONNECT_CLIENT_DATA_ID id, DWORD size) {
+  SimConnect_MapClientDataNameToID(hSimConnect, name.c_str(), id);
+  SimConnect_CreateClientData(hSimConnect, id, size, SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT);
+}
+
+void requestArea(HANDLE hSimConnect,
+                 const std::string& name,
+                 SIMCONNECT_CLIENT_DATA_ID id,
+                 SIMCONNECT_DATA_REQUEST_ID requestId,
+                 SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId) {
+  SimConnect_MapClientDataNameToID(hSimConnect, name.c_str(), id);
+  SimConnect_RequestClientData(hSimConnect, id, requestId, definitionId, SIMCONNECT_CLIENT_DATA_PERIOD_ON_SET);
+}
+
+}  // namespace
+
+int main() {
+  HANDLE hSimConnect{};
+  if (!SUCCEEDED(SimConnect_Open(&hSimConnect, "Stream Meta Loss Test", nullptr, 0, nullptr, 0))) {
+    std::cerr << "FAIL: cannot open the loopback" << std::endl;
+    return 1;
+  }
+  SimConnect_AddToClientDataDefinition(hSimConnect, META_DEFINITION_ID, 0, sizeof(StreamMetaData));
+  SimConnect_AddToClientDataDefinition(hSimConnect, CHUNK_DEFINITION_ID, 0, StreamChunkSize);
+  SimConnect_AddToClientDataDefinition(hSimConnect, ACK_DEFINITION_ID, 0, sizeof(StreamAck));
+  createArea(hSimConnect, META_NAME, META_ID, sizeof(StreamMetaData));
+  createArea(hSimConnect, DATA_NAME, DATA_ID, StreamChunkSize);
+  createArea(hSimConnect, ACK_NAME, ACK_ID, sizeof(StreamAck));
+  requestArea(hSimConnect, META_ECHO_NAME, META_ECHO_ID, META_REQUEST_ID, META_DEFINITION_ID);
+  requestArea(hSimConnect, DATA_ECHO_NAME, DATA_ECHO_ID, DATA_REQUEST_ID, CHUNK_DEFINITION_ID);
+  requestArea(hSimConnect, ACK_ECHO_NAME, ACK_ECHO_ID, ACK_REQUEST_ID, ACK_DEFINITION_ID);
+  SimConnectLoopback::mirrorClientData(DATA_NAME, DATA_ECHO_NAME);
+  SimConnectLoopback::mirrorClientData(ACK_NAME, ACK_ECHO_NAME);
+  // the peer loses the first meta data message and forwards the later ones
+  int metaDataWrites = 0;
+  SimConnectLoopback::onClientSetData(META_NAME, [&metaDataWrites](const std::string&, const char* data, DWORD size) {
+    if (++metaDataWrites > 1) {
+      SimConnectLoopback::peerSetClientData(META_ECHO_NAME, data, size);
+    }
+  });
+
+  const std::string& data = longText;
+  StreamMetaData meta{};
+  meta.size = data.size();
+  meta.hash = fingerprint(data.data(), data.size(), DefaultFingerprintAlgorithm);
+  meta.algorithm = DefaultFingerprintAlgorithm;
+  meta.ackWindow = WINDOW;
+  meta.stripeCount = 1;
+  meta.compression = StreamCompression::NONE;
+  meta.streamId = STREAM_ID;
+  const size_t payloadSize = streamChunkPayloadSize(hasChunkHeader(meta));
+
+  // receiver side - acks every chunk
+  bool complete = false;
+  bool match = false;
+  StreamDemultiplexer receiver(nullptr, 1);
+  receiver.onProgress([&](uint32_t streamId, const StreamReassembler& stream) {
+    StreamAck ack{stream.ackedChunks(), streamId};
+    SimConnect_SetClientData(hSimConnect, ACK_ID, ACK_DEFINITION_ID, SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, sizeof(ack), &ack);
+  });
+  receiver.onComplete([&](uint32_t, const StreamReassembler& stream) {
+    complete = true;
+    match = stream.digest() == meta.hash;
+  });
+
+  // sender side
+  std::vector<char> buffer(StreamChunkSize);
+  const auto sendMetaData = [&] {
+    SimConnect_SetClientData(hSimConnect, META_ID, META_DEFINITION_ID, SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, sizeof(meta), &meta);
+  };
+  const auto sendChunk = [&](uint32_t sequence) {
+    const size_t offset = sequence * payloadSize;
+    const StreamChunkHeader header{sequence, STREAM_ID};
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    std::memcpy(buffer.data() + sizeof(header), data.data() + offset, std::min(payloadSize, data.size() - offset));
+    return SUCCEEDED(SimConnect_SetClientData(hSimConnect, DATA_ID, CHUNK_DEFINITION_ID, SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0,
+                                              StreamChunkSize, buffer.data()));
+  };
+  SlidingWindowSender sender(WINDOW, ACK_TIMEOUT);
+  sendMetaData();
+  sender.start(static_cast<uint32_t>(chunkCount(data.size(), payloadSize)));
+
+  const auto deadline = Clock::now() + TEST_TIMEOUT;
+  while (sender.isActive() && Clock::now() < deadline) {
+    sender.pump(sendChunk, sendMetaData);
+    SIMCONNECT_RECV* pData = nullptr;
+    DWORD cbData = 0;
+    while (SUCCEEDED(SimConnect_GetNextDispatch(hSimConnect, &pData, &cbData))) {
+      if (pData->dwID != SIMCONNECT_RECV_ID_CLIENT_DATA) {
+        continue;
+      }
+      const auto* pClientData = reinterpret_cast<SIMCONNECT_RECV_CLIENT_DATA*>(pData);
+      const auto* payload = reinterpret_cast<const char*>(&pClientData->dwData);
+      if (pClientData->dwRequestID == META_REQUEST_ID) {
+        StreamMetaData received{};
+        std::memcpy(&received, payload, sizeof(received));
+        receiver.start(received);
+      } else if (pClientData->dwRequestID == DATA_REQUEST_ID) {
+        receiver.onChunk(payload);
+      } else if (pClientData->dwRequestID == ACK_REQUEST_ID) {
+        StreamAck ack{};
+        std::memcpy(&ack, payload, sizeof(ack));
+        sender.onAck(ack.ackedChunks);
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  SimConnect_Close(hSimConnect);
+
+  std::cout << "meta data writes: " << metaDataWrites << " meta data resends: " << sender.startResendCount()
+            << " timeouts: " << sender.timeoutCount() << " orphan chunks: " << receiver.stats().orphanChunks << std::endl;
+  if (!sender.isDone() || !complete || !match) {
+    std::cerr << "FAIL: stream not completed after its first meta data was lost (sender done " << sender.isDone() << ", received "
+              << complete << ", match " << match << ")" << std::endl;
+    return 1;
+  }
+  if (sender.startResendCount() == 0 || metaDataWrites < 2) {
+    std::cerr << "FAIL: meta data was not sent again" << std::endl;
+    return 1;
+  }
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
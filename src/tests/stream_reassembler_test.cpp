@@ -0,0 +1,185 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+// Checks that StreamReassembler rejects meta data with sizes and counts it cannot hold before
+// allocating for them - the meta data comes straight from the wire - and that a sink whose
+// destination is too small is closed when the stream falls back to the stream buffer.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "fingerprint.h"
+#include "streamdemultiplexer.h"
+#include "streamprotocol.h"
+#include "streamreassembler.h"
+#include "streamsink.h"
+#include "treefingerprint.h"
+
+namespace {
+
+constexpr uint32_t STREAM_ID = 1;
+constexpr size_t STREAM_SIZE = 100000;
+
+StreamMetaData validMetaData() {
+  StreamMetaData meta{};
+  meta.size = STREAM_SIZE;
+  meta.algorithm = DefaultFingerprintAlgorithm;
+  meta.stripeCount = 1;
+  meta.compression = StreamCompression::NONE;
+  meta.streamId = STREAM_ID;
+  return meta;
+}
+
+// provides a destination too small for the stream and records how it is closed
+class UndersizedSink : public StreamSink {
+ public:
+  std::span<char> open([[maybe_unused]] const StreamMetaData& metaData, size_t size) override {
+    opens++;
+    destination.resize(std::min(size - 1, STREAM_SIZE));
+    return destination;
+  }
+
+  void close(bool complete) override {
+    closes++;
+    closedComplete = complete;
+  }
+
+  std::vector<char> destination;
+  int opens = 0;
+  int closes = 0;
+  bool closedComplete = false;
+};
+
+bool expectRejected(const std::string& name, const StreamMetaData& meta) {
+  StreamReassembler reassembler;
+  if (reassembler.start(meta)) {
+    std::cerr << "FAIL: " << name << " accepted" << std::endl;
+    return false;
+  }
+  // capacity - a rejected stream must not even allocate temporarily
+  if (reassembler.chunkCount() != 0 || !reassembler.data().empty() || reassembler.chunkHashes().capacity() != 0) {
+    std::cerr << "FAIL: " << name << " allocated for the stream" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  const size_t payloadSize = streamChunkPayloadSize(hasChunkHeader(validMetaData()));
+
+  StreamMetaData hugeHashCount = validMetaData();
+  hugeHashCount.chunkHashCount = UINT32_MAX;
+  StreamMetaData wrongHashCount = validMetaData();
+  wrongHashCount.chunkHashCount = static_cast<uint32_t>(chunkCount(STREAM_SIZE, payloadSize)) + 1;
+  StreamMetaData empty = validMetaData();
+  empty.size = 0;
+  StreamMetaData hugeSize = validMetaData();
+  hugeSize.size = SIZE_MAX;
+  StreamMetaData hugeCompressedSize = validMetaData();
+  hugeCompressedSize.compression = StreamCompression::LZ4;
+  hugeCompressedSize.compressedSize = SIZE_MAX;
+  StreamMetaData unbufferedSize = validMetaData();
+  unbufferedSize.size = StreamReassembler::MAX_BUFFERED_SIZE + 1;
+  // a few compressed bytes must not make the receiver decompress into a huge buffer
+  StreamMetaData hugeDecompressedSize = validMetaData();
+  hugeDecompressedSize.size = StreamReassembler::MAX_STREAM_SIZE;
+  hugeDecompressedSize.compression = StreamCompression::LZ4;
+  hugeDecompressedSize.compressedSize = 100;
+  StreamMetaData compressedLarger = validMetaData();
+  compressedLarger.compression = StreamCompression::LZ4;
+  compressedLarger.compressedSize = STREAM_SIZE + 1;
+  StreamMetaData unknownCompression = validMetaData();
+  unknownCompression.compression = static_cast<StreamCompression>(7);
+  unknownCompression.compressedSize = 100;
+  // valid in itself, but its chunk hashes alone would take about 1 GB
+  StreamMetaData hugeWithHashes = validMetaData();
+  hugeWithHashes.size = StreamReassembler::MAX_STREAM_SIZE;
+  hugeWithHashes.chunkHashCount = static_cast<uint32_t>(chunkCount(hugeWithHashes.size, payloadSize));
+  if (!expectRejected("huge chunk hash count", hugeHashCount) || !expectRejected("chunk hash count not matching the size", wrongHashCount) ||
+      !expectRejected("huge size", hugeSize) || !expectRejected("huge compressed size", hugeCompressedSize) ||
+      !expectRejected("size above the stream buffer limit", unbufferedSize) ||
+      !expectRejected("huge size with matching chunk hash count", hugeWithHashes) ||
+      !expectRejected("huge size of a compressed stream", hugeDecompressedSize) ||
+      !expectRejected("compressed size larger than the size", compressedLarger) ||
+      !expectRejected("unknown compression", unknownCompression) || !expectRejected("empty stream", empty)) {
+    return 1;
+  }
+
+  // a stream too large for the stream buffer and for its sink is rejected without allocating and the sink is closed
+  UndersizedSink smallSink;
+  StreamReassembler smallSinkReassembler;
+  if (smallSinkReassembler.start(unbufferedSize, &smallSink) || smallSink.closes != 1 || smallSink.closedComplete ||
+      smallSinkReassembler.chunkHashes().capacity() != 0 || !smallSinkReassembler.data().empty()) {
+    std::cerr << "FAIL: stream too large for the sink and the stream buffer not rejected (closes " << smallSink.closes << ")" << std::endl;
+    return 1;
+  }
+
+  // valid meta data - flat, with chunk hashes and compressed
+  StreamMetaData withHashes = validMetaData();
+  withHashes.chunkHashCount = static_cast<uint32_t>(chunkCount(STREAM_SIZE, payloadSize));
+  StreamMetaData compressed = validMetaData();
+  compressed.compression = StreamCompression::LZ4;
+  compressed.compressedSize = STREAM_SIZE / 2;
+  StreamReassembler reassembler;
+  if (!reassembler.start(validMetaData()) || !reassembler.start(compressed) || !reassembler.start(withHashes) ||
+      reassembler.chunkHashes().size() != withHashes.chunkHashCount) {
+    std::cerr << "FAIL: valid meta data rejected" << std::endl;
+    return 1;
+  }
+
+  // the demultiplexer does not keep a slot for a rejected stream - an empty stream without chunk headers would otherwise
+  // never complete and take the chunks of every other stream
+  StreamMetaData emptyHeaderless = empty;
+  emptyHeaderless.streamId = 0;
+  StreamDemultiplexer streams(nullptr, 1);
+  if (streams.start(hugeHashCount) || streams.start(emptyHeaderless) || streams.stats().invalid != 2 || streams.activeCount() != 0 ||
+      !streams.start(validMetaData())) {
+    std::cerr << "FAIL: demultiplexer kept the rejected stream (invalid " << streams.stats().invalid << ", in progress "
+              << streams.activeCount() << ")" << std::endl;
+    return 1;
+  }
+  std::vector<char> routedChunk(StreamChunkSize);
+  const StreamChunkHeader routedHeader{0, STREAM_ID};
+  std::memcpy(routedChunk.data(), &routedHeader, sizeof(routedHeader));
+  bool routed = false;
+  streams.onProgress([&routed](uint32_t streamId, const StreamReassembler& stream) {
+    routed = streamId == STREAM_ID && stream.receivedChunks() == 1;
+  });
+  if (!streams.onChunk(routedChunk.data()) || !routed) {
+    std::cerr << "FAIL: chunk not routed to its stream after an empty stream" << std::endl;
+    return 1;
+  }
+  // a sink too small for the stream is closed as abandoned and the stream is received into the stream buffer
+  const std::string data(STREAM_SIZE, 'x');
+  StreamMetaData flat = validMetaData();
+  flat.hash = fingerprint(data.data(), data.size(), flat.algorithm);
+  UndersizedSink sink;
+  StreamReassembler sinkReassembler;
+  if (!sinkReassembler.start(flat, &sink) || sinkReassembler.usesSink() || sink.opens != 1 || sink.closes != 1 || sink.closedComplete) {
+    std::cerr << "FAIL: undersized sink not closed as abandoned (closes " << sink.closes << ", complete " << sink.closedComplete << ")"
+              << std::endl;
+    return 1;
+  }
+  std::vector<char> chunk(StreamChunkSize);
+  for (uint32_t sequence = 0; sequence < sinkReassembler.chunkCount(); sequence++) {
+    const StreamChunkHeader header{sequence, STREAM_ID};
+    const size_t offset = sequence * payloadSize;
+    std::memcpy(chunk.data(), &header, sizeof(header));
+    std::memcpy(chunk.data() + sizeof(header), data.data() + offset, std::min(payloadSize, data.size() - offset));
+    sinkReassembler.onChunk(chunk.data());
+  }
+  sinkReassembler.release();
+  if (!sinkReassembler.isComplete() || sinkReassembler.digest() != flat.hash || sink.closes != 1) {
+    std::cerr << "FAIL: stream of the undersized sink not received into the stream buffer (closes " << sink.closes << ")" << std::endl;
+    return 1;
+  }
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
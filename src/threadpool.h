@@ -0,0 +1,116 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_THREADPOOL_H
+#define FBW_CPP_FRAMEWORK_TEST_THREADPOOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed size thread pool for CPU bound work like verifying stream chunks.
+ *
+ * Usage:
+ *
+ * ThreadPool pool;
+ * auto future = pool.submit([] { return 42; });
+ * pool.parallelFor(chunkCount, [&](size_t i) { verify(i); });
+ */
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threadCount = std::max(1U, std::thread::hardware_concurrency())) {
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+      workers.emplace_back([this] { workerLoop(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    condition.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  /** Queues a task and returns a future for its result. */
+  template <typename F>
+  auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+    auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(task));
+    auto future = packaged->get_future();
+    {
+      std::lock_guard lock(mutex);
+      tasks.emplace([packaged] { (*packaged)(); });
+    }
+    condition.notify_one();
+    return future;
+  }
+
+  /**
+   * Calls body(i) for every i in [0, count) distributed over the pool and waits for completion.
+   * Indexes are split into one contiguous block per worker to keep the per-task overhead low.
+   */
+  template <typename F>
+  void parallelFor(size_t count, F&& body) {
+    if (count == 0) {
+      return;
+    }
+    const size_t blocks = std::min(count, workers.size());
+    const size_t blockSize = (count + blocks - 1) / blocks;
+    std::vector<std::future<void>> futures;
+    futures.reserve(blocks);
+    for (size_t begin = 0; begin < count; begin += blockSize) {
+      const size_t end = std::min(count, begin + blockSize);
+      futures.push_back(submit([begin, end, &body] {
+        for (size_t i = begin; i < end; i++) {
+          body(i);
+        }
+      }));
+    }
+    for (auto& future : futures) {
+      future.get();
+    }
+  }
+
+  [[nodiscard]] size_t size() const { return workers.size(); }
+
+ private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+
+  void workerLoop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (stopping && tasks.empty()) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop();
+      }
+      task();
+    }
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_THREADPOOL_H
@@ -0,0 +1,109 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+// Prints the records of a binary trace file written by TraceLog, oldest first.
+//
+// Records which were being written or overwritten while the process stopped are reported as torn.
+// Times are relative to the first printed record, the wall clock time of that record is printed first.
+//
+// Usage: trace-decode <trace file> [event name]...
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tracelog.h"
+
+namespace {
+
+bool selected(const std::vector<std::string>& filter, uint16_t event) {
+  if (filter.empty()) {
+    return true;
+  }
+  for (const auto& name : filter) {
+    if (name == traceEventName(event)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string wallClock(uint64_t systemNs) {
+  const auto seconds = static_cast<std::time_t>(systemNs / 1000000000);
+  char text[32];
+  std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", std::localtime(&seconds));
+  std::ostringstream out;
+  out << text << "." << std::setw(6) << std::setfill('0') << systemNs % 1000000000 / 1000;
+  return out.str();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: trace-decode <trace file> [event name]..." << std::endl;
+    return 2;
+  }
+  const std::vector<std::string> filter(argv + 2, argv + argc);
+
+  std::ifstream file(argv[1], std::ios::binary);
+  TraceFileHeader header{};
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    std::cerr << "Cannot read " << argv[1] << std::endl;
+    return 1;
+  }
+  if (std::memcmp(header.magic, TraceFileHeader::MAGIC, sizeof(header.magic)) != 0 || header.version != TraceFileHeader::VERSION ||
+      header.recordSize != sizeof(TraceRecord) || header.capacity == 0) {
+    std::cerr << argv[1] << " is not a trace file of this version" << std::endl;
+    return 1;
+  }
+  std::vector<TraceRecord> ring(header.capacity);
+  file.read(reinterpret_cast<char*>(ring.data()), static_cast<std::streamsize>(ring.size() * sizeof(TraceRecord)));
+  if (!file) {
+    std::cerr << argv[1] << " is truncated" << std::endl;
+    return 1;
+  }
+
+  const uint64_t first = header.head > header.capacity ? header.head - header.capacity : 0;
+  std::cout << "Records: " << header.head << " written, " << header.head - first << " in the ring of " << header.capacity << std::endl;
+
+  std::map<uint16_t, uint64_t> counts;
+  uint64_t torn = 0;
+  bool started = false;
+  uint64_t start = 0;
+  for (uint64_t index = first; index < header.head; index++) {
+    const TraceRecord& r = ring[index % header.capacity];
+    if (r.sequence != static_cast<uint32_t>(index + 1)) {
+      torn++;
+      continue;
+    }
+    if (!selected(filter, r.event)) {
+      continue;
+    }
+    if (!started) {
+      started = true;
+      start = r.timestamp;
+      std::cout << "First record at " << wallClock(header.systemStart + (r.timestamp - header.steadyStart)) << std::endl;
+    }
+    counts[r.event]++;
+    std::cout << std::fixed << std::setprecision(3) << std::setw(12) << static_cast<double>(r.timestamp - start) / 1e6 << " ms"
+              << "  T" << std::left << std::setw(3) << r.thread << std::setw(26) << traceEventName(r.event) << std::right
+              << " request " << std::setw(5) << r.requestId << " chunk " << std::setw(6) << r.chunkIndex << " size " << std::setw(8) << r.size
+              << " value " << r.value << std::endl;
+  }
+
+  std::cout << "---" << std::endl;
+  for (const auto& [event, count] : counts) {
+    std::cout << std::left << std::setw(26) << traceEventName(event) << std::right << std::setw(10) << count << std::endl;
+  }
+  if (torn > 0) {
+    std::cout << "Torn or overwritten records: " << torn << std::endl;
+  }
+  return 0;
+}
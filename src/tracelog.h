@@ -0,0 +1,290 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_TRACELOG_H
+#define FBW_CPP_FRAMEWORK_TEST_TRACELOG_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Events of the binary trace. New events are only appended - the values are stored in trace files.
+ */
+enum class TraceEvent : uint16_t {
+  NONE = 0,
+  /** requestId = request ID (or 0), value = SIMCONNECT_RECV_ID, size = message size */
+  MESSAGE_RECEIVED,
+  /** requestId = client data area ID, value = definition ID, size = bytes - from the send queue */
+  CLIENT_DATA_SENT,
+  /** as CLIENT_DATA_SENT */
+  CLIENT_DATA_SEND_FAILED,
+  /** requestId = stream ID for all STREAM_* events, size = stream bytes on the wire, value = chunk count */
+  STREAM_SEND_STARTED,
+  /** chunkIndex = sequence, size = payload bytes, value = stripe area ID */
+  STREAM_CHUNK_QUEUED,
+  /** chunkIndex = number of cumulatively acknowledged chunks */
+  STREAM_ACK_RECEIVED,
+  /** size = bytes sent, value = chunk count */
+  STREAM_SEND_COMPLETED,
+  /** size = stream bytes on the wire, value = stripe count */
+  STREAM_RECEIVE_STARTED,
+  /** chunkIndex = number of received chunks including this one, size = received bytes so far */
+  STREAM_CHUNK_RECEIVED,
+  /** size = stream bytes, value = 1 if the fingerprint matched */
+  STREAM_RECEIVE_COMPLETED,
+  /** size = compressed bytes */
+  STREAM_DECOMPRESS_FAILED,
+  /** chunkIndex = index of the corrupt chunk */
+  STREAM_CORRUPT_CHUNK,
+  COUNT
+};
+
+/** @return the name of a trace event - "?" for unknown values, e.g. from a newer trace file */
+constexpr const char* traceEventName(uint16_t event) {
+  constexpr const char* names[] = {
+      "NONE",
+      "MESSAGE_RECEIVED",
+      "CLIENT_DATA_SENT",
+      "CLIENT_DATA_SEND_FAILED",
+      "STREAM_SEND_STARTED",
+      "STREAM_CHUNK_QUEUED",
+      "STREAM_ACK_RECEIVED",
+      "STREAM_SEND_COMPLETED",
+      "STREAM_RECEIVE_STARTED",
+      "STREAM_CHUNK_RECEIVED",
+      "STREAM_RECEIVE_COMPLETED",
+      "STREAM_DECOMPRESS_FAILED",
+      "STREAM_CORRUPT_CHUNK",
+  };
+  static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(TraceEvent::COUNT));
+  return event < static_cast<uint16_t>(TraceEvent::COUNT) ? names[event] : "?";
+}
+
+/** One trace record as stored in the file. */
+struct TraceRecord {
+  /** steady clock time in ns */
+  uint64_t timestamp;
+  /** index of the record + 1 (truncated) - written last, a mismatch marks a torn or overwritten record */
+  uint32_t sequence;
+  uint16_t event;
+  /** small number of the writing thread in the order the threads first traced */
+  uint16_t thread;
+  uint32_t requestId;
+  uint32_t chunkIndex;
+  /** bytes - saturated at UINT32_MAX, e.g. for multi-GB file streams */
+  uint32_t size;
+  uint32_t value;
+};
+static_assert(sizeof(TraceRecord) == 32);
+
+/** Header at the start of a trace file - followed by capacity records. */
+struct TraceFileHeader {
+  static constexpr char MAGIC[8] = {'F', 'B', 'W', 'T', 'R', 'A', 'C', 'E'};
+  static constexpr uint32_t VERSION = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  /** number of records - a power of two */
+  uint64_t capacity;
+  /** steady and system clock in ns when the file was opened - to convert the timestamps to wall clock time */
+  uint64_t steadyStart;
+  uint64_t systemStart;
+  /** number of records ever written - the newest record is at (head - 1) % capacity */
+  alignas(8) uint64_t head;
+  uint64_t reserved[2];
+};
+static_assert(sizeof(TraceFileHeader) == 64);
+
+/**
+ * Always-on binary trace of protocol events in a memory-mapped ring file.
+ *
+ * Each event is a fixed size record (timestamp, event, request ID, chunk index, size, value) written
+ * straight into a shared file mapping - no formatting, no system call, no lock. The oldest records are
+ * overwritten when the ring is full. The OS writes the mapping back to the file, so the trace
+ * survives a crash of the process and can be decoded afterwards with the trace-decode tool.
+ *
+ * record() does nothing until open() succeeded. Any thread may record.
+ *
+ * Usage:
+ *
+ * traceLog->open("fbw.trace", 1 << 16);
+ * traceLog->record(TraceEvent::STREAM_CHUNK_QUEUED, streamId, sequence, size, areaId);
+ */
+class TraceLog {
+ public:
+  static TraceLog* instance() {
+    static TraceLog instance;
+    return &instance;
+  }
+
+  TraceLog(const TraceLog&) = delete;
+  TraceLog& operator=(const TraceLog&) = delete;
+
+  ~TraceLog() { close(); }
+
+  /**
+   * Creates or truncates the trace file and maps it.
+   * @param capacity number of records - rounded up to a power of two
+   * @return false if the file could not be created or mapped
+   */
+  bool open(const std::string& path, uint64_t capacity) {
+    close();
+    uint64_t records = 1;
+    while (records < capacity) {
+      records <<= 1;
+    }
+    const size_t fileSize = sizeof(TraceFileHeader) + records * sizeof(TraceRecord);
+    void* view = map(path, fileSize);
+    if (view == nullptr) {
+      return false;
+    }
+    auto* header = static_cast<TraceFileHeader*>(view);
+    std::memcpy(header->magic, TraceFileHeader::MAGIC, sizeof(header->magic));
+    header->version = TraceFileHeader::VERSION;
+    header->recordSize = sizeof(TraceRecord);
+    header->capacity = records;
+    header->steadyStart = now();
+    header->systemStart = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    header->head = 0;
+    mask = records - 1;
+    fileHeader = header;
+    this->records.store(reinterpret_cast<TraceRecord*>(header + 1), std::memory_order_release);
+    return true;
+  }
+
+  /** Unmaps the trace file - records written afterwards are dropped. Not safe against concurrent record() calls. */
+  void close() {
+    if (fileHeader == nullptr) {
+      return;
+    }
+    records.store(nullptr, std::memory_order_release);
+    unmap();
+    fileHeader = nullptr;
+  }
+
+  [[nodiscard]] bool isOpen() const { return records.load(std::memory_order_relaxed) != nullptr; }
+
+  /** Appends a record to the ring. */
+  void record(TraceEvent event, uint32_t requestId = 0, uint32_t chunkIndex = 0, uint64_t size = 0, uint32_t value = 0) {
+    TraceRecord* const ring = records.load(std::memory_order_acquire);
+    if (ring == nullptr) {
+      return;
+    }
+    const uint64_t index = std::atomic_ref<uint64_t>(fileHeader->head).fetch_add(1, std::memory_order_relaxed);
+    TraceRecord& r = ring[index & mask];
+    r.timestamp = now();
+    r.event = static_cast<uint16_t>(event);
+    r.thread = threadNumber();
+    r.requestId = requestId;
+    r.chunkIndex = chunkIndex;
+    r.size = static_cast<uint32_t>(std::min<uint64_t>(size, UINT32_MAX));
+    r.value = value;
+    std::atomic_ref<uint32_t>(r.sequence).store(static_cast<uint32_t>(index + 1), std::memory_order_release);
+  }
+
+  /** @return number of records written since open() */
+  [[nodiscard]] uint64_t recordCount() const {
+    return isOpen() ? std::atomic_ref<uint64_t>(fileHeader->head).load(std::memory_order_relaxed) : 0;
+  }
+
+ private:
+  TraceLog() = default;
+
+  std::atomic<TraceRecord*> records{nullptr};
+  TraceFileHeader* fileHeader = nullptr;
+  uint64_t mask = 0;
+  size_t mappedSize = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static uint16_t threadNumber() {
+    static std::atomic<uint16_t> nextThread{0};
+    thread_local const uint16_t number = nextThread.fetch_add(1, std::memory_order_relaxed);
+    return number;
+  }
+
+#ifdef _WIN32
+  void* map(const std::string& path, size_t size) {
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return nullptr;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                 static_cast<DWORD>(size), nullptr);
+    void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : nullptr;
+    if (view == nullptr) {
+      unmap();
+      return nullptr;
+    }
+    mappedSize = size;
+    return view;
+  }
+
+  void unmap() {
+    if (fileHeader != nullptr) {
+      UnmapViewOfFile(fileHeader);
+    }
+    if (mapping != nullptr) {
+      CloseHandle(mapping);
+      mapping = nullptr;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+      CloseHandle(file);
+      file = INVALID_HANDLE_VALUE;
+    }
+  }
+#else
+  void* map(const std::string& path, size_t size) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      return nullptr;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      unmap();
+      return nullptr;
+    }
+    void* view = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+      unmap();
+      return nullptr;
+    }
+    mappedSize = size;
+    return view;
+  }
+
+  void unmap() {
+    if (fileHeader != nullptr) {
+      ::munmap(fileHeader, mappedSize);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+#endif
+};
+
+inline TraceLog* traceLog = TraceLog::instance();
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_TRACELOG_H
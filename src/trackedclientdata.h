@@ -0,0 +1,193 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_TRACKEDCLIENTDATA_H
+#define FBW_CPP_FRAMEWORK_TEST_TRACKEDCLIENTDATA_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "SimConnect.h"
+#include "sendqueue.h"
+#include "trafficcapture.h"
+
+/**
+ * Client data variable of a struct type which remembers what was last written to the sim.
+ *
+ * flush() compares the value with that copy and skips the SimConnect call entirely if nothing
+ * changed. With span writes enabled only the bytes from the first to the last changed field are
+ * sent, using a client data definition with a single datum at the span's offset (SetClientData has
+ * no offset parameter). Span definitions are added on first use from the reserved ID block
+ * firstSpanDefinitionId .. firstSpanDefinitionId + maxSpanDefinitions - 1. When the block is used
+ * up the whole struct is written instead.
+ *
+ * Usage:
+ *
+ * TrackedClientData<Example2ClientData> example2(EXAMPLE2_CLIENT_DATA_ID, EXAMPLE2_CLIENT_DATA_DEFINITION_ID,
+ *                                                EXAMPLE2_CLIENT_DATA_SPAN_DEFINITION_ID, 8);
+ * example2.set(&Example2ClientData::anInt8, 5);  // or example2.modify().anInt8 = 5;
+ * example2.flush(hSimConnect);                   // no SimConnect call if nothing changed
+ */
+template <typename T>
+class TrackedClientData {
+  static_assert(std::is_trivially_copyable_v<T>, "client data must be trivially copyable");
+  static_assert(sizeof(T) <= SIMCONNECT_CLIENTDATA_MAX_SIZE, "client data exceeds SIMCONNECT_CLIENTDATA_MAX_SIZE");
+
+ public:
+  /**
+   * @param definitionId definition covering the whole struct - used for full writes
+   * @param firstSpanDefinitionId first ID of the block reserved for span definitions
+   * @param maxSpanDefinitions size of the reserved block - 0 disables span writes
+   */
+  TrackedClientData(SIMCONNECT_CLIENT_DATA_ID clientDataId,
+                    SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId,
+                    SIMCONNECT_CLIENT_DATA_DEFINITION_ID firstSpanDefinitionId = 0,
+                    uint32_t maxSpanDefinitions = 0)
+      : areaId(clientDataId), fullDefinition(definitionId), firstSpanDefinition(firstSpanDefinitionId), maxSpans(maxSpanDefinitions) {}
+
+  [[nodiscard]] const T& get() const { return value; }
+
+  /** @return the value for changing fields directly - changes are found by flush() */
+  T& modify() { return value; }
+
+  /** Sets a single field. */
+  template <typename M>
+  void set(M T::*field, const M& fieldValue) {
+    value.*field = fieldValue;
+  }
+
+  /** @return true if the field differs from what was last written to the sim */
+  template <typename M>
+  [[nodiscard]] bool isChanged(M T::*field) const {
+    const size_t offset = fieldOffset(field);
+    return forceWrite || std::memcmp(bytes(value) + offset, bytes(written) + offset, sizeof(M)) != 0;
+  }
+
+  /** @return true if any field differs from what was last written to the sim */
+  [[nodiscard]] bool isDirty() const { return forceWrite || std::memcmp(&value, &written, sizeof(T)) != 0; }
+
+  /**
+   * Takes over data received from the sim - the value is clean afterwards as the sim already has it.
+   */
+  void onReceived(const void* data) {
+    std::memcpy(&value, data, sizeof(T));
+    written = value;
+    forceWrite = false;
+  }
+
+  /** Forces the next flush() to write the whole struct and to add the span definitions again - call after reconnecting. */
+  void invalidate() {
+    forceWrite = true;
+    spans.clear();
+  }
+
+  /** Forces the next flush() to write the whole struct - call when a queued write failed, see SendQueue::onFailed(). */
+  void markStale() { forceWrite = true; }
+
+  /**
+   * Writes the changed part of the value to the sim.
+   * @param sendQueue if given the write is queued there instead of sent right away - the value counts as written once queued,
+   *                  a failed queued write has to be reported with markStale()
+   * @return false if the SimConnect call failed - the value stays dirty and is written with the next flush
+   */
+  bool flush(HANDLE hSimConnect, SendQueue* sendQueue = nullptr) {
+    size_t first = 0;
+    size_t end = sizeof(T);
+    if (!forceWrite) {
+      while (first < sizeof(T) && bytes(value)[first] == bytes(written)[first]) {
+        first++;
+      }
+      if (first == sizeof(T)) {
+        avoidedWrites++;
+        avoidedBytes += sizeof(T);
+        return true;
+      }
+      while (bytes(value)[end - 1] == bytes(written)[end - 1]) {
+        end--;
+      }
+    }
+
+    SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId = fullDefinition;
+    if (end - first < sizeof(T) && !spanDefinition(hSimConnect, first, end - first, definitionId)) {
+      first = 0;
+      end = sizeof(T);
+    }
+    const auto size = static_cast<DWORD>(end - first);
+    if (sendQueue != nullptr) {
+      sendQueue->set(areaId, definitionId, bytes(value) + first, size);
+    } else if (!SUCCEEDED(SimConnect_SetClientData(hSimConnect, areaId, definitionId, SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, size,
+                                                   bytes(value) + first))) {
+      return false;
+    } else {
+      trafficCapture->recordSent(areaId, definitionId, bytes(value) + first, size);
+    }
+    std::memcpy(bytes(written) + first, bytes(value) + first, size);
+    forceWrite = false;
+    (size < sizeof(T) ? spanWrites : fullWrites)++;
+    writtenBytes += size;
+    avoidedBytes += sizeof(T) - size;
+    return true;
+  }
+
+  /** @return number of flushes without a SimConnect call because nothing changed */
+  [[nodiscard]] uint64_t avoidedWriteCount() const { return avoidedWrites; }
+  /** @return number of bytes not sent compared to writing the whole struct on every flush */
+  [[nodiscard]] uint64_t avoidedByteCount() const { return avoidedBytes; }
+  [[nodiscard]] uint64_t spanWriteCount() const { return spanWrites; }
+  [[nodiscard]] uint64_t fullWriteCount() const { return fullWrites; }
+  [[nodiscard]] uint64_t writtenByteCount() const { return writtenBytes; }
+
+ private:
+  struct Span {
+    size_t offset;
+    size_t size;
+  };
+
+  SIMCONNECT_CLIENT_DATA_ID areaId;
+  SIMCONNECT_CLIENT_DATA_DEFINITION_ID fullDefinition;
+  SIMCONNECT_CLIENT_DATA_DEFINITION_ID firstSpanDefinition;
+  uint32_t maxSpans;
+  std::vector<Span> spans;  // span definitions added so far - index + firstSpanDefinition is the definition ID
+
+  T value{};
+  T written{};
+  bool forceWrite = true;  // the sim side content is unknown until the first write
+
+  uint64_t avoidedWrites = 0;
+  uint64_t avoidedBytes = 0;
+  uint64_t spanWrites = 0;
+  uint64_t fullWrites = 0;
+  uint64_t writtenBytes = 0;
+
+  static const char* bytes(const T& t) { return reinterpret_cast<const char*>(&t); }
+  static char* bytes(T& t) { return reinterpret_cast<char*>(&t); }
+
+  template <typename M>
+  static size_t fieldOffset(M T::*field) {
+    static const T probe{};
+    return static_cast<size_t>(reinterpret_cast<const char*>(&(probe.*field)) - bytes(probe));
+  }
+
+  /** Finds or adds the definition for a span. @return false if no span definition is available */
+  bool spanDefinition(HANDLE hSimConnect, size_t offset, size_t size, SIMCONNECT_CLIENT_DATA_DEFINITION_ID& definitionId) {
+    for (size_t i = 0; i < spans.size(); i++) {
+      if (spans[i].offset == offset && spans[i].size == size) {
+        definitionId = firstSpanDefinition + static_cast<SIMCONNECT_CLIENT_DATA_DEFINITION_ID>(i);
+        return true;
+      }
+    }
+    if (spans.size() >= maxSpans) {
+      return false;
+    }
+    definitionId = firstSpanDefinition + static_cast<SIMCONNECT_CLIENT_DATA_DEFINITION_ID>(spans.size());
+    if (!SUCCEEDED(SimConnect_AddToClientDataDefinition(hSimConnect, definitionId, static_cast<DWORD>(offset), static_cast<DWORD>(size)))) {
+      return false;
+    }
+    spans.push_back({offset, size});
+    return true;
+  }
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_TRACKEDCLIENTDATA_H
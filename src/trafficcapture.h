@@ -0,0 +1,284 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_TRAFFICCAPTURE_H
+#define FBW_CPP_FRAMEWORK_TEST_TRAFFICCAPTURE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "SimConnect.h"
+#include "mappedfile.h"
+
+/**
+ * Direction of a captured message. The values are stored in capture files.
+ */
+enum class TrafficDirection : uint16_t {
+  /** message received from SimConnect - requestId = request ID (or 0), value = SIMCONNECT_RECV_ID, payload = the message */
+  RECEIVED = 1,
+  /** client data written with SimConnect_SetClientData - requestId = client data area ID, value = definition ID, payload = the data */
+  SENT = 2,
+};
+
+/** Header at the start of a capture file - followed by the records. */
+struct TrafficFileHeader {
+  static constexpr char MAGIC[8] = {'F', 'B', 'W', 'T', 'R', 'A', 'F', 'F'};
+  static constexpr uint32_t VERSION = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t recordHeaderSize;
+  /** system clock in ns when the capture started - the record timestamps are relative to it */
+  uint64_t systemStart;
+  uint64_t reserved;
+};
+static_assert(sizeof(TrafficFileHeader) == 32);
+
+/** Header of one captured message - followed by size bytes of payload, padded to a multiple of 8. */
+struct TrafficRecordHeader {
+  /** steady clock time in ns since the capture started */
+  uint64_t timestamp;
+  uint16_t direction;
+  uint16_t reserved;
+  uint32_t requestId;
+  uint32_t value;
+  uint32_t size;
+};
+static_assert(sizeof(TrafficRecordHeader) == 24);
+
+/** @return size of the payload as stored in the file - records start at multiples of 8 so payloads can be used in place */
+constexpr size_t trafficPaddedSize(size_t size) {
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+/**
+ * Capture of the SimConnect traffic into a compact binary file - for replaying it without the sim.
+ *
+ * Every received message and every client data write is appended with its time, IDs and payload.
+ * The records are collected in a buffer and written when it is full, so capturing costs a copy of
+ * the message. Records still buffered when the process is killed are lost - call flush()
+ * periodically. A reader stops at a record cut off that way.
+ *
+ * The recording calls do nothing until open() succeeded. Not thread safe - received messages and
+ * writes are captured on the main thread where they are dispatched and flushed.
+ *
+ * Usage:
+ *
+ * trafficCapture->open("traffic.bin");
+ * trafficCapture->recordReceived(pRecv, cbData);
+ * trafficCapture->recordSent(areaId, definitionId, data, size);
+ * trafficCapture->flush();  // e.g. once a second
+ * trafficCapture->close();
+ */
+class TrafficCapture {
+ public:
+  static TrafficCapture* instance() {
+    static TrafficCapture instance;
+    return &instance;
+  }
+
+  TrafficCapture(const TrafficCapture&) = delete;
+  TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+  ~TrafficCapture() { close(); }
+
+  /**
+   * Creates or truncates the capture file.
+   * @param bufferBytes records are written to the file once this many bytes are buffered
+   * @return false if the file could not be created
+   */
+  bool open(const std::string& path, size_t bufferBytes = 1024 * 1024) {
+    close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      return false;
+    }
+    TrafficFileHeader header{};
+    std::memcpy(header.magic, TrafficFileHeader::MAGIC, sizeof(header.magic));
+    header.version = TrafficFileHeader::VERSION;
+    header.recordHeaderSize = sizeof(TrafficRecordHeader);
+    header.systemStart = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    start = std::chrono::steady_clock::now();
+    flushBytes = bufferBytes;
+    buffer.reserve(bufferBytes + sizeof(TrafficRecordHeader) + SIMCONNECT_CLIENTDATA_MAX_SIZE);
+    records = 0;
+    bytes = sizeof(header);
+    capturing = true;
+    return true;
+  }
+
+  /** Writes the buffered records and closes the file. */
+  void close() {
+    if (!capturing) {
+      return;
+    }
+    flush();
+    file.close();
+    capturing = false;
+  }
+
+  [[nodiscard]] bool isOpen() const { return capturing; }
+
+  /** Writes the buffered records to the file. */
+  void flush() {
+    if (!capturing || buffer.empty()) {
+      return;
+    }
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.flush();
+    buffer.clear();
+  }
+
+  /** Appends a message received from SimConnect. */
+  void recordReceived(const SIMCONNECT_RECV* pRecv, DWORD cbData) {
+    if (!capturing) {
+      return;
+    }
+    const bool withRequestId = pRecv->dwID == SIMCONNECT_RECV_ID_CLIENT_DATA || pRecv->dwID == SIMCONNECT_RECV_ID_SIMOBJECT_DATA;
+    const DWORD requestId = withRequestId ? static_cast<const SIMCONNECT_RECV_SIMOBJECT_DATA*>(pRecv)->dwRequestID : 0;
+    append(TrafficDirection::RECEIVED, requestId, pRecv->dwID, pRecv, cbData);
+  }
+
+  /** Appends a client data write. */
+  void recordSent(SIMCONNECT_CLIENT_DATA_ID areaId, SIMCONNECT_CLIENT_DATA_DEFINITION_ID definitionId, const void* data, DWORD size) {
+    if (!capturing) {
+      return;
+    }
+    append(TrafficDirection::SENT, areaId, definitionId, data, size);
+  }
+
+  /** @return number of records captured since open() */
+  [[nodiscard]] uint64_t recordCount() const { return records; }
+
+  /** @return size of the capture file including the records not yet written */
+  [[nodiscard]] uint64_t byteCount() const { return bytes; }
+
+ private:
+  TrafficCapture() = default;
+
+  std::ofstream file;
+  std::vector<char> buffer;
+  size_t flushBytes = 0;
+  std::chrono::steady_clock::time_point start;
+  uint64_t records = 0;
+  uint64_t bytes = 0;
+  bool capturing = false;
+
+  void append(TrafficDirection direction, uint32_t requestId, uint32_t value, const void* data, DWORD size) {
+    TrafficRecordHeader header{};
+    header.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    header.direction = static_cast<uint16_t>(direction);
+    header.requestId = requestId;
+    header.value = value;
+    header.size = size;
+    const size_t offset = buffer.size();
+    const size_t recordSize = sizeof(header) + trafficPaddedSize(size);
+    buffer.resize(offset + recordSize);
+    std::memcpy(buffer.data() + offset, &header, sizeof(header));
+    std::memcpy(buffer.data() + offset + sizeof(header), data, size);
+    std::memset(buffer.data() + offset + sizeof(header) + size, 0, recordSize - sizeof(header) - size);
+    records++;
+    bytes += recordSize;
+    if (buffer.size() >= flushBytes) {
+      flush();
+    }
+  }
+};
+
+inline TrafficCapture* trafficCapture = TrafficCapture::instance();
+
+/**
+ * Reader of a capture file written by TrafficCapture.
+ *
+ * The file is memory-mapped and read ahead as a whole when opened. The records are handed out in
+ * place, so a replay copies nothing - payloads start at multiples of 8 bytes.
+ *
+ * Usage:
+ *
+ * TrafficReader reader;
+ * if (reader.open("traffic.bin")) {
+ *   TrafficReader::Record record{};
+ *   while (reader.next(record)) { replay(record.header->direction, record.payload); }
+ * }
+ */
+class TrafficReader {
+ public:
+  /** A record of the file - valid while the reader is open. */
+  struct Record {
+    const TrafficRecordHeader* header;
+    const char* payload;
+  };
+
+  /**
+   * Maps the capture file and checks its header.
+   * @return false if the file could not be mapped or is no capture file of this version
+   */
+  bool open(const std::string& path) {
+    position = 0;
+    truncated = false;
+    if (!file.openRead(path) || file.size() < sizeof(TrafficFileHeader)) {
+      file.close();
+      return false;
+    }
+    TrafficFileHeader header{};
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, TrafficFileHeader::MAGIC, sizeof(header.magic)) != 0 || header.version != TrafficFileHeader::VERSION ||
+        header.recordHeaderSize != sizeof(TrafficRecordHeader)) {
+      file.close();
+      return false;
+    }
+    systemStartNs = header.systemStart;
+    position = sizeof(header);
+    file.prefetch(0, file.size());
+    return true;
+  }
+
+  /** Starts reading from the first record again. */
+  void rewind() {
+    position = file.isOpen() ? sizeof(TrafficFileHeader) : 0;
+    truncated = false;
+  }
+
+  /**
+   * Reads the next record.
+   * @return false at the end of the file or at a truncated last record - see isTruncated()
+   */
+  bool next(Record& record) {
+    if (!file.isOpen() || position + sizeof(TrafficRecordHeader) > file.size()) {
+      truncated = file.isOpen() && position < file.size();
+      return false;
+    }
+    const auto* header = reinterpret_cast<const TrafficRecordHeader*>(file.data() + position);
+    const size_t recordSize = sizeof(TrafficRecordHeader) + trafficPaddedSize(header->size);
+    if (position + recordSize > file.size()) {
+      truncated = true;
+      return false;
+    }
+    record.header = header;
+    record.payload = file.data() + position + sizeof(TrafficRecordHeader);
+    position += recordSize;
+    return true;
+  }
+
+  /** @return true if the file ended within a record, e.g. the capturing process crashed */
+  [[nodiscard]] bool isTruncated() const { return truncated; }
+
+  /** @return system clock in ns when the capture started */
+  [[nodiscard]] uint64_t systemStart() const { return systemStartNs; }
+
+  /** @return size of the capture file */
+  [[nodiscard]] size_t size() const { return file.size(); }
+
+ private:
+  MappedFile file;
+  size_t position = 0;
+  uint64_t systemStartNs = 0;
+  bool truncated = false;
+};
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_TRAFFICCAPTURE_H
@@ -0,0 +1,88 @@
+// Copyright (c) 2023 FlyByWire Simulations
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef FBW_CPP_FRAMEWORK_TEST_TREEFINGERPRINT_H
+#define FBW_CPP_FRAMEWORK_TEST_TREEFINGERPRINT_H
+
+#include <cstdint>
+#include <vector>
+
+#include "fingerprint.h"
+#include "threadpool.h"
+
+/**
+ * Tree fingerprint of a stream: one fingerprint per chunk and a root fingerprint over the chunk fingerprints.
+ *
+ * Compared to a flat fingerprint the chunks can be hashed and verified in parallel and a mismatch can be
+ * narrowed down to the corrupt chunks so only those need to be resent.
+ */
+struct TreeFingerprint {
+  std::vector<uint64_t> chunkHashes;
+  uint64_t root = 0;
+};
+
+/** @return number of chunks a stream of the given size is split into */
+constexpr size_t chunkCount(size_t size, size_t chunkSize) {
+  return (size + chunkSize - 1) / chunkSize;
+}
+
+/** @return the root fingerprint over the given chunk fingerprints */
+inline uint64_t treeRoot(const std::vector<uint64_t>& chunkHashes, FingerprintAlgorithm algorithm) {
+  return fingerprint(chunkHashes, algorithm);
+}
+
+/**
+ * Calculates the tree fingerprint of data. Chunks are hashed on the pool if one is given.
+ */
+inline TreeFingerprint treeFingerprint(const void* data,
+                                       size_t size,
+                                       size_t chunkSize,
+                                       FingerprintAlgorithm algorithm,
+                                       ThreadPool* pool = nullptr) {
+  const auto* const bytes = static_cast<const char*>(data);
+  TreeFingerprint tree{};
+  tree.chunkHashes.resize(chunkCount(size, chunkSize));
+  const auto hashChunk = [&](size_t i) {
+    const size_t offset = i * chunkSize;
+    tree.chunkHashes[i] = fingerprint(bytes + offset, std::min(chunkSize, size - offset), algorithm);
+  };
+  if (pool != nullptr) {
+    pool->parallelFor(tree.chunkHashes.size(), hashChunk);
+  } else {
+    for (size_t i = 0; i < tree.chunkHashes.size(); i++) {
+      hashChunk(i);
+    }
+  }
+  tree.root = treeRoot(tree.chunkHashes, algorithm);
+  return tree;
+}
+
+/**
+ * Verifies data against expected chunk fingerprints in parallel.
+ * @return the indexes of all chunks which do not match, in ascending order - empty if all chunks are intact
+ */
+inline std::vector<size_t> findCorruptChunks(const void* data,
+                                             size_t size,
+                                             size_t chunkSize,
+                                             const std::vector<uint64_t>& expectedChunkHashes,
+                                             FingerprintAlgorithm algorithm,
+                                             ThreadPool& pool) {
+  const auto* const bytes = static_cast<const char*>(data);
+  const size_t count = chunkCount(size, chunkSize);
+  // one flag per chunk - written by exactly one worker each, no synchronization needed
+  std::vector<char> corrupt(count, 0);
+  pool.parallelFor(count, [&](size_t i) {
+    const size_t offset = i * chunkSize;
+    const uint64_t hash = fingerprint(bytes + offset, std::min(chunkSize, size - offset), algorithm);
+    corrupt[i] = i >= expectedChunkHashes.size() || hash != expectedChunkHashes[i];
+  });
+  std::vector<size_t> result;
+  for (size_t i = 0; i < count; i++) {
+    if (corrupt[i]) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+#endif  // FBW_CPP_FRAMEWORK_TEST_TREEFINGERPRINT_H